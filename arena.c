@@ -0,0 +1,59 @@
+#include "arena.h"
+
+void initArena(arenaPtr arena){
+	arena->blocks = NULL;
+}
+
+void freeArena(arenaPtr arena){
+	struct arena_block *block, *next;
+
+	for(block = arena->blocks; block != NULL; block = next){
+		next = block->next;
+		free(block);
+	}
+	arena->blocks = NULL;
+}
+
+//carves size bytes aligned to align out of the arena, align is a power of 2 no larger than ARENA_ALIGN
+void *allocAligned(arenaPtr arena, size_t size, size_t align){
+	struct arena_block *block = arena->blocks;
+	size_t blockSize, start = 0;
+	void *memory;
+
+	if(block != NULL)
+		start = (block->used + align - 1) & ~(align - 1);
+
+	if(block == NULL || start > block->size || block->size - start < size){
+		blockSize = (size > ARENA_BLOCK) ? size : ARENA_BLOCK;
+		block = (struct arena_block *) malloc(sizeof(struct arena_block) + blockSize);
+		block->size = blockSize;
+		block->used = 0;
+		start = 0;
+
+		//a block made for one large request goes behind the one being filled so its free space is not lost
+		if(blockSize > ARENA_BLOCK && arena->blocks != NULL){
+			block->next = arena->blocks->next;
+			arena->blocks->next = block;
+		}
+		else{
+			block->next = arena->blocks;
+			arena->blocks = block;
+		}
+	}
+
+	memory = block->data + start;
+	block->used = start + size;
+	return memory;
+}
+
+void *arenaAlloc(arenaPtr arena, size_t size){
+	return allocAligned(arena, size, ARENA_ALIGN);
+}
+
+char *arenaDup(arenaPtr arena, const char *text, size_t length){
+	char *copy = (char *) allocAligned(arena, length + 1, 1); //strings need no alignment, they are packed
+
+	memcpy(copy, text, length);
+	copy[length] = '\0';
+	return copy;
+}
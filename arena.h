@@ -0,0 +1,46 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stddef.h>
+
+/*
+ * Bump allocator
+ *
+ * An arena hands out memory from large blocks by moving a pointer, nothing it
+ * hands out is freed on its own: everything goes at once when the arena is
+ * freed. Meant for objects that live until the end of the run, allocated by one
+ * thread; an arena is not locked, every thread that allocates keeps its own or
+ * holds a lock around it.
+ */
+
+#define ARENA_BLOCK (64 << 10) //bytes in a block, larger requests get a block to themselves
+#define ARENA_ALIGN 16 //every allocation is aligned to this, a power of 2
+
+struct arena_block{
+	struct arena_block *next;
+	size_t size;
+	size_t used;
+	_Alignas(ARENA_ALIGN) char data[];
+};
+
+struct arena{
+	struct arena_block *blocks; //the block being filled first
+};
+typedef struct arena * arenaPtr;
+
+// Sets up an empty arena, no memory is taken until the first allocation
+void initArena(arenaPtr arena);
+
+// Frees every block of the arena and everything allocated from it
+void freeArena(arenaPtr arena);
+
+// Returns size bytes aligned to ARENA_ALIGN, valid until the arena is freed
+void *arenaAlloc(arenaPtr arena, size_t size);
+
+// Copies length characters of text into the arena as a null terminated string
+char *arenaDup(arenaPtr arena, const char *text, size_t length);
+
+#endif
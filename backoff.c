@@ -0,0 +1,41 @@
+#include "backoff.h"
+#include <stdlib.h>
+#include <unistd.h>
+
+void initWaitPolicy(waitPolicyPtr policy){
+	policy->spins = (sysconf(_SC_NPROCESSORS_ONLN) > 1) ? DEFAULT_SPINS : 0;
+	policy->yields = DEFAULT_YIELDS;
+}
+
+int parseWaitPolicy(const char *text, waitPolicyPtr policy){
+	char *end;
+	long spins, yields;
+
+	spins = strtol(text, &end, 10);
+	if(end == text || spins < 0)
+		return -1;
+	yields = policy->yields;
+	if(*end == ','){
+		text = end + 1;
+		yields = strtol(text, &end, 10);
+		if(end == text || yields < 0)
+			return -1;
+	}
+	if(*end != '\0')
+		return -1;
+
+	policy->spins = spins;
+	policy->yields = yields;
+	return 0;
+}
+
+int backoff(const struct wait_policy *policy, int *step){
+	if(*step < policy->spins)
+		cpuRelax();
+	else if(*step < policy->spins + policy->yields)
+		sched_yield();
+	else
+		return 0;
+	(*step)++;
+	return 1;
+}
@@ -0,0 +1,47 @@
+#ifndef BACKOFF_H
+#define BACKOFF_H
+
+#include <sched.h>
+
+/*
+ * Spin, then yield, then park
+ *
+ * A thread that finds it has to wait usually only has to wait a moment, so it
+ * first spins on the condition with a pause between looks, then gives up its
+ * time slice a few times, and only then goes to sleep in the kernel. The
+ * policy says how long each of the first two stages lasts, a policy of all
+ * zeros parks straight away.
+ */
+
+#define DEFAULT_SPINS 128 //looks with a pause between them before yielding, on machines with more than one core
+#define DEFAULT_YIELDS 8 //time slices given up before parking
+
+struct wait_policy{
+	int spins;
+	int yields;
+};
+typedef struct wait_policy * waitPolicyPtr;
+
+// Sets up the default policy for this machine, a single core never spins since the
+// thread being waited for cannot run until the spinning one stops
+void initWaitPolicy(waitPolicyPtr policy);
+
+// Reads "spins[,yields]" into the policy
+// returns 0 on success, -1 if text is not a valid policy
+int parseWaitPolicy(const char *text, waitPolicyPtr policy);
+
+// Waits one step of the policy, step starts at 0 and counts the steps taken
+// returns 1 if the caller should look at its condition again, 0 once it is time to park
+int backoff(const struct wait_policy *policy, int *step);
+
+// Tells the core this thread is spinning, lets the other hyperthread run and
+// saves power without giving up the time slice
+static inline void cpuRelax(void){
+#if defined(__x86_64__) || defined(__i386__)
+	__builtin_ia32_pause();
+#elif defined(__aarch64__)
+	__asm__ __volatile__("yield");
+#endif
+}
+
+#endif
@@ -0,0 +1,52 @@
+#include "bench.h"
+
+double secondsBetween(struct timespec *from, struct timespec *to){
+	return (to->tv_sec - from->tv_sec) + (to->tv_nsec - from->tv_nsec) / 1e9;
+}
+
+void startClock(struct bench_clock *clock){
+	clock_gettime(CLOCK_MONOTONIC, &clock->wall);
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &clock->cpu);
+}
+
+double wallSeconds(struct bench_clock *clock){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return secondsBetween(&clock->wall, &now);
+}
+
+double cpuSeconds(struct bench_clock *clock){
+	struct timespec now;
+
+	clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+	return secondsBetween(&clock->cpu, &now);
+}
+
+int64_t nowNanos(){
+	struct timespec now;
+
+	clock_gettime(CLOCK_MONOTONIC, &now);
+	return (int64_t) now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+long argOr(int argc, char **argv, int i, long fallback){
+	long value;
+
+	if(i >= argc)
+		return fallback;
+	value = strtol(argv[i], NULL, 10);
+	if(value <= 0){
+		fprintf(stderr, "%s: argument %d must be a positive number\n", argv[0], i);
+		exit(1);
+	}
+	return value;
+}
+
+uint32_t benchRandom(uint32_t *state){
+	//xorshift, the same generator the sorted list uses for its heights
+	*state ^= *state << 13;
+	*state ^= *state >> 17;
+	*state ^= *state << 5;
+	return *state;
+}
@@ -0,0 +1,43 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <time.h>
+
+/*
+ * Benchmark helpers
+ *
+ * Every benchmark is its own program linked against the simulator's modules,
+ * `make bench` builds and runs them all with their default sizes. Each one
+ * takes its sizes as optional arguments to run larger cases by hand. Numbers
+ * only mean something with optimization on:
+ *     make clean && make bench CFLAGS="-O2 -Wall -pthread"
+ */
+
+//wall clock and cpu time at one moment, the cpu time is summed over every thread of the process
+struct bench_clock{
+	struct timespec wall;
+	struct timespec cpu;
+};
+
+// Reads both clocks
+void startClock(struct bench_clock *clock);
+
+// Seconds of wall clock time since startClock
+double wallSeconds(struct bench_clock *clock);
+
+// Seconds of cpu time all threads used since startClock
+double cpuSeconds(struct bench_clock *clock);
+
+// Nanoseconds on the monotonic clock, for timing single operations
+int64_t nowNanos();
+
+// Reads argument i as a positive number, or returns fallback if it is missing
+long argOr(int argc, char **argv, int i, long fallback);
+
+// Cheap reproducible random numbers, every benchmark generates its input from a fixed seed
+uint32_t benchRandom(uint32_t *state);
+
+#endif
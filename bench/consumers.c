@@ -0,0 +1,160 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "bench.h"
+#include "custtable.h"
+#include "order.h"
+#include "sales.h"
+
+/*
+ * Scaling of order processing with the number of consumers
+ *
+ * A fixed number of orders is split over 1, 2, 4, ... consumer threads. Every
+ * order does what runCategory does for it: looks the customer up, debits the
+ * balance and records the sale in the consumer's own run. The balance is
+ * guarded by one global lock, as lockConsumerDB used to, by a lock striped by
+ * customer id, as the program does without ATOMIC_BALANCES, and, where 64 bit
+ * atomics are lock free, by nothing but debitBalance's compare and swap.
+ *
+ * usage: consumers [customers] [orders] [max consumers]
+ */
+
+#define BENCH_STRIPES 256 //as CUSTOMER_STRIPES in thread.h
+#define START_BALANCE 100000000 //cents, enough that most debits go through
+
+enum balance_guard{ GLOBAL_LOCK, STRIPED_LOCKS, NO_LOCK };
+const char *guardNames[] = { "global lock", "striped locks", "lock free" };
+
+struct customer_table customers;
+pthread_mutex_t globalLock = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t stripes[BENCH_STRIPES];
+pthread_barrier_t startLine;
+
+struct consumer{
+	pthread_t tid;
+	enum balance_guard guard;
+	int *ids; //customer of every order, shared by all consumers
+	long first;
+	long count;
+	struct sale_run accepted, rejected;
+};
+
+void *consume(void *args){
+	struct consumer *consumer = (struct consumer *) args;
+	customerPtr customer;
+	pthread_mutex_t *lock;
+	int64_t price, balance;
+	long i;
+	int id, accepted;
+
+	pthread_barrier_wait(&startLine);
+	for(i = consumer->first; i < consumer->first + consumer->count; i++){
+		id = consumer->ids[i];
+		price = 100 + i % 5000;
+		customer = getCustomer(&customers, id);
+		if(customer == NULL)
+			continue;
+
+		if(consumer->guard == NO_LOCK){
+			accepted = debitBalance(customer, price, &balance);
+		}
+		else{
+			lock = (consumer->guard == GLOBAL_LOCK) ? &globalLock : &stripes[(unsigned int) id & (BENCH_STRIPES - 1)];
+			pthread_mutex_lock(lock);
+			accepted = debitBalance(customer, price, &balance);
+			pthread_mutex_unlock(lock);
+		}
+
+		if(accepted)
+			appendSale(&consumer->accepted, id, NULL, price, balance, i);
+		else
+			appendSale(&consumer->rejected, id, NULL, price, balance, i);
+	}
+	return NULL;
+}
+
+void resetBalances(int numCustomers){
+	int id;
+
+	for(id = 1; id <= numCustomers; id++)
+		getCustomer(&customers, id)->balance = START_BALANCE;
+}
+
+//runs every order over numConsumers threads, returns the wall clock seconds it took
+double runConsumers(enum balance_guard guard, int numConsumers, int *ids, long numOrders){
+	struct consumer *consumers = (struct consumer *) calloc(numConsumers, sizeof(struct consumer));
+	struct bench_clock clock;
+	double wall;
+	int i;
+
+	pthread_barrier_init(&startLine, NULL, numConsumers + 1);
+	for(i = 0; i < numConsumers; i++){
+		consumers[i].guard = guard;
+		consumers[i].ids = ids;
+		consumers[i].first = numOrders * i / numConsumers;
+		consumers[i].count = numOrders * (i + 1) / numConsumers - consumers[i].first;
+		initSaleRun(&consumers[i].accepted);
+		initSaleRun(&consumers[i].rejected);
+		pthread_create(&consumers[i].tid, NULL, consume, &consumers[i]);
+	}
+	startClock(&clock);
+	pthread_barrier_wait(&startLine);
+	for(i = 0; i < numConsumers; i++)
+		pthread_join(consumers[i].tid, NULL);
+	wall = wallSeconds(&clock);
+
+	for(i = 0; i < numConsumers; i++){
+		freeSaleRun(&consumers[i].accepted);
+		freeSaleRun(&consumers[i].rejected);
+	}
+	pthread_barrier_destroy(&startLine);
+	free(consumers);
+	return wall;
+}
+
+int main(int argc, char **argv){
+	int numCustomers = argOr(argc, argv, 1, 100000);
+	long numOrders = argOr(argc, argv, 2, 4000000);
+	int maxConsumers = argOr(argc, argv, 3, 8);
+	struct CustomerStruct customer;
+	uint32_t seed = 2463534242u;
+	double single[NO_LOCK + 1], wall;
+	int *ids;
+	int id, n, guard, numGuards;
+	long i;
+
+	memset(&customer, 0, sizeof(customer));
+	initCustomerTable(&customers, numCustomers);
+	for(id = 1; id <= numCustomers; id++)
+		addCustomer(&customers, id, &customer);
+	finishCustomerTable(&customers);
+	for(i = 0; i < BENCH_STRIPES; i++)
+		pthread_mutex_init(&stripes[i], NULL);
+
+	ids = (int *) malloc(numOrders * sizeof(int));
+	for(i = 0; i < numOrders; i++)
+		ids[i] = benchRandom(&seed) % numCustomers + 1;
+
+#ifdef ATOMIC_BALANCES
+	numGuards = NO_LOCK + 1;
+#else
+	numGuards = NO_LOCK; //without lock free 64 bit atomics debitBalance needs a lock
+#endif
+
+	//consumers past the number of cpus can only show the cost of contention, not scaling
+	printf("consumers: %d customers, %ld orders, %ld cpus\n", numCustomers, numOrders, sysconf(_SC_NPROCESSORS_ONLN));
+	for(n = 1; n <= maxConsumers; n *= 2){
+		printf("  %2d consumers", n);
+		for(guard = 0; guard < numGuards; guard++){
+			resetBalances(numCustomers);
+			wall = runConsumers(guard, n, ids, numOrders);
+			if(n == 1)
+				single[guard] = wall;
+			printf("   %s %6.2f M orders/s (x%.2f)", guardNames[guard], numOrders / wall / 1e6, single[guard] / wall);
+		}
+		printf("\n");
+	}
+
+	free(ids);
+	clearCustomerTable(&customers);
+	return 0;
+}
@@ -0,0 +1,118 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "bench.h"
+#include "custtable.h"
+#include "order.h"
+
+/*
+ * Contention on customer balances
+ *
+ * Several consumers debit customers picked at random from a hot set, from one
+ * customer that every debit goes to up to the whole table. The makefile builds
+ * this file twice: bench/debit uses debitBalance's compare and swap, and
+ * bench/debit-locked is built with -DLOCKED_BALANCES and takes the customer's
+ * striped lock around the debit as runCategory does in such a build.
+ *
+ * usage: debit [consumers] [debits per consumer]
+ */
+
+#define BENCH_STRIPES 256 //as CUSTOMER_STRIPES in thread.h
+#define NUM_CUSTOMERS 100000
+#define START_BALANCE 1000000000000LL //cents, no debit is refused
+
+struct customer_table customers;
+#ifndef ATOMIC_BALANCES
+pthread_mutex_t stripes[BENCH_STRIPES];
+#endif
+pthread_barrier_t startLine;
+
+struct debitor{
+	pthread_t tid;
+	int hotSet; //customers 1 to hotSet get every debit
+	long numDebits;
+	uint32_t seed;
+	long accepted;
+};
+
+void *debitCustomers(void *args){
+	struct debitor *debitor = (struct debitor *) args;
+	customerPtr customer;
+	int64_t balance;
+	long i;
+	int id;
+
+	pthread_barrier_wait(&startLine);
+	for(i = 0; i < debitor->numDebits; i++){
+		id = benchRandom(&debitor->seed) % debitor->hotSet + 1;
+		customer = getCustomer(&customers, id);
+#ifdef ATOMIC_BALANCES
+		debitor->accepted += debitBalance(customer, 1 + i % 100, &balance);
+#else
+		pthread_mutex_lock(&stripes[(unsigned int) id & (BENCH_STRIPES - 1)]);
+		debitor->accepted += debitBalance(customer, 1 + i % 100, &balance);
+		pthread_mutex_unlock(&stripes[(unsigned int) id & (BENCH_STRIPES - 1)]);
+#endif
+	}
+	return NULL;
+}
+
+void runHotSet(int hotSet, int numDebitors, long numDebits){
+	struct debitor *debitors = (struct debitor *) calloc(numDebitors, sizeof(struct debitor));
+	struct bench_clock clock;
+	double wall, cpu;
+	long total = 0;
+	int i;
+
+	pthread_barrier_init(&startLine, NULL, numDebitors + 1);
+	for(i = 0; i < numDebitors; i++){
+		debitors[i].hotSet = hotSet;
+		debitors[i].numDebits = numDebits;
+		debitors[i].seed = 2463534242u + i;
+		pthread_create(&debitors[i].tid, NULL, debitCustomers, &debitors[i]);
+	}
+	startClock(&clock);
+	pthread_barrier_wait(&startLine);
+	for(i = 0; i < numDebitors; i++){
+		pthread_join(debitors[i].tid, NULL);
+		total += debitors[i].accepted;
+	}
+	wall = wallSeconds(&clock);
+	cpu = cpuSeconds(&clock);
+
+	if(total != numDebits * numDebitors){
+		fprintf(stderr, "debits were refused\n");
+		exit(1);
+	}
+	printf("  %6d hot customers   %7.2f M debits/s   %6.1f ns/debit   cpu %5.2f s\n", hotSet,
+		total / wall / 1e6, wall * 1e9 / total, cpu);
+	pthread_barrier_destroy(&startLine);
+	free(debitors);
+}
+
+int main(int argc, char **argv){
+	int numDebitors = argOr(argc, argv, 1, 4);
+	long numDebits = argOr(argc, argv, 2, 1000000);
+	int hotSets[] = { 1, 16, 256, NUM_CUSTOMERS };
+	struct CustomerStruct customer;
+	int id, i;
+
+	memset(&customer, 0, sizeof(customer));
+	customer.balance = START_BALANCE;
+	initCustomerTable(&customers, NUM_CUSTOMERS);
+	for(id = 1; id <= NUM_CUSTOMERS; id++)
+		addCustomer(&customers, id, &customer);
+	finishCustomerTable(&customers);
+
+#ifdef ATOMIC_BALANCES
+	printf("debit: compare and swap, %d consumers, %ld debits each, %ld cpus\n", numDebitors, numDebits, sysconf(_SC_NPROCESSORS_ONLN));
+#else
+	for(i = 0; i < BENCH_STRIPES; i++)
+		pthread_mutex_init(&stripes[i], NULL);
+	printf("debit: striped locks, %d consumers, %ld debits each, %ld cpus\n", numDebitors, numDebits, sysconf(_SC_NPROCESSORS_ONLN));
+#endif
+	for(i = 0; i < (int) (sizeof(hotSets) / sizeof(hotSets[0])); i++)
+		runHotSet(hotSets[i], numDebitors, numDebits);
+
+	clearCustomerTable(&customers);
+	return 0;
+}
@@ -0,0 +1,115 @@
+#include "bench.h"
+#include "custtable.h"
+#include "uthash.h"
+
+/*
+ * Customer lookups, flat table against uthash
+ *
+ * The customer table of custtable.c against the uthash table the customers
+ * used to live in: one malloc per entry, the customer behind one more pointer
+ * and chained buckets. Both are built from the same ids and then looked up at
+ * random ids that are all present. Compact ids 1 to n turn the flat table into
+ * a directly indexed array, sparse ids keep it hashed.
+ *
+ * A customer slot takes 48 bytes, 100M customers need about 5GB for the flat
+ * table and more for uthash.
+ *
+ * usage: lookup [customers] [lookups]
+ */
+
+#define SPARSE_GAP 19 //sparse ids are spread over this many values per customer
+
+//an entry of the old customer hash
+struct customerHash{
+	int customer_key;
+	customerPtr customer_info;
+	UT_hash_handle hh;
+};
+typedef struct customerHash * customerHashPtr;
+
+void runLayout(const char *layout, int sparse, int numCustomers, long numLookups){
+	struct customer_table table;
+	customerHashPtr hash = NULL, entry, tmp;
+	struct CustomerStruct customer;
+	struct bench_clock clock;
+	uint32_t seed = 2463534242u;
+	double flatBuild, hashBuild, flatLookup, hashLookup;
+	int64_t flatSum = 0, hashSum = 0;
+	int *ids, *keys;
+	customerPtr found;
+	long i;
+
+	memset(&customer, 0, sizeof(customer));
+	ids = (int *) malloc(numCustomers * sizeof(int));
+	for(i = 0; i < numCustomers; i++)
+		ids[i] = sparse ? (int) (i * SPARSE_GAP + benchRandom(&seed) % SPARSE_GAP) : (int) (i + 1);
+	keys = (int *) malloc(numLookups * sizeof(int));
+	for(i = 0; i < numLookups; i++)
+		keys[i] = ids[benchRandom(&seed) % numCustomers];
+
+	startClock(&clock);
+	initCustomerTable(&table, numCustomers);
+	for(i = 0; i < numCustomers; i++){
+		customer.balance = ids[i];
+		addCustomer(&table, ids[i], &customer);
+	}
+	finishCustomerTable(&table);
+	flatBuild = wallSeconds(&clock);
+
+	startClock(&clock);
+	for(i = 0; i < numCustomers; i++){
+		entry = (customerHashPtr) malloc(sizeof(struct customerHash));
+		entry->customer_key = ids[i];
+		entry->customer_info = (customerPtr) malloc(sizeof(struct CustomerStruct));
+		*entry->customer_info = customer;
+		entry->customer_info->balance = ids[i];
+		HASH_ADD_INT(hash, customer_key, entry);
+	}
+	hashBuild = wallSeconds(&clock);
+
+	startClock(&clock);
+	for(i = 0; i < numLookups; i++){
+		found = getCustomer(&table, keys[i]);
+		flatSum += found->balance;
+	}
+	flatLookup = wallSeconds(&clock);
+
+	startClock(&clock);
+	for(i = 0; i < numLookups; i++){
+		HASH_FIND_INT(hash, &keys[i], entry);
+		hashSum += entry->customer_info->balance;
+	}
+	hashLookup = wallSeconds(&clock);
+
+	if(flatSum != hashSum){
+		fprintf(stderr, "the tables disagree\n");
+		exit(1);
+	}
+	printf("  %-7s %-19s build %6.2f s   lookup %6.1f ns\n", layout, table.dense ? "flat table (dense)" : "flat table (hashed)",
+		flatBuild, flatLookup * 1e9 / numLookups);
+	printf("  %-7s %-19s build %6.2f s   lookup %6.1f ns\n", layout, "uthash",
+		hashBuild, hashLookup * 1e9 / numLookups);
+
+	//the buckets go all at once, then the entries are freed along the hash's list without unlinking each one
+	entry = hash;
+	HASH_CLEAR(hh, hash);
+	while(entry != NULL){
+		tmp = (customerHashPtr) entry->hh.next;
+		free(entry->customer_info);
+		free(entry);
+		entry = tmp;
+	}
+	clearCustomerTable(&table);
+	free(keys);
+	free(ids);
+}
+
+int main(int argc, char **argv){
+	int numCustomers = argOr(argc, argv, 1, 1000000);
+	long numLookups = argOr(argc, argv, 2, 4000000);
+
+	printf("lookup: %d customers, %ld random lookups\n", numCustomers, numLookups);
+	runLayout("compact", 0, numCustomers, numLookups);
+	runLayout("sparse", 1, numCustomers, numLookups);
+	return 0;
+}
@@ -0,0 +1,198 @@
+#include <pthread.h>
+#include <sched.h>
+#include "bench.h"
+#include "order.h"
+#include "thread.h"
+
+/*
+ * Throughput of one producer and one consumer through a category buffer
+ *
+ * The lock free ring of order.c, pushed and popped one order at a time and a
+ * batch at a time, against the mutex and two condition variable ring the
+ * buffers used to be. The old ring is kept here only for the comparison, it
+ * holds orders by value like the new one so only the synchronization differs.
+ *
+ * usage: ring [orders] [capacity]
+ *        without a capacity both the default buffer size and a large one are run
+ */
+
+#define BENCH_BATCH ORDER_BATCH //orders moved at once in batch mode, as the producers and workers do
+#define BIG_CAPACITY 1024
+
+//the mutex and condvar ring as init_order_buf used to set it up
+struct locked_ring{
+	struct info_t *buf;
+	int size;
+	int count;
+	int front;
+	int rear;
+	int closed;
+	pthread_mutex_t mutex;
+	pthread_cond_t dataAvailable;
+	pthread_cond_t spaceAvailable;
+};
+
+struct ring_run{
+	struct locked_ring locked;
+	orderBufferPtr ring;
+	struct wait_policy policy;
+	long numOrders;
+	int batch; //orders moved at once, 1 for one at a time
+	long checksum; //summed by the consumer so the orders are really read
+};
+
+void *lockedProducer(void *args){
+	struct ring_run *run = (struct ring_run *) args;
+	struct locked_ring *lr = &run->locked;
+	struct info_t order;
+	long i;
+
+	for(i = 0; i < run->numOrders; i++){
+		init_newOrder(&order, (int) i, NULL, i, i);
+		pthread_mutex_lock(&lr->mutex);
+		while(lr->count == lr->size)
+			pthread_cond_wait(&lr->spaceAvailable, &lr->mutex);
+		lr->buf[lr->rear] = order;
+		lr->rear = (lr->rear + 1) % lr->size;
+		lr->count++;
+		pthread_cond_signal(&lr->dataAvailable);
+		pthread_mutex_unlock(&lr->mutex);
+	}
+	pthread_mutex_lock(&lr->mutex);
+	lr->closed = 1;
+	pthread_cond_signal(&lr->dataAvailable);
+	pthread_mutex_unlock(&lr->mutex);
+	return NULL;
+}
+
+void *lockedConsumer(void *args){
+	struct ring_run *run = (struct ring_run *) args;
+	struct locked_ring *lr = &run->locked;
+	struct info_t order;
+
+	while(1){
+		pthread_mutex_lock(&lr->mutex);
+		while(lr->count == 0 && !lr->closed)
+			pthread_cond_wait(&lr->dataAvailable, &lr->mutex);
+		if(lr->count == 0){
+			pthread_mutex_unlock(&lr->mutex);
+			return NULL;
+		}
+		order = lr->buf[lr->front];
+		lr->front = (lr->front + 1) % lr->size;
+		lr->count--;
+		pthread_cond_signal(&lr->spaceAvailable);
+		pthread_mutex_unlock(&lr->mutex);
+		run->checksum += order.bookprice;
+	}
+}
+
+void *ringProducer(void *args){
+	struct ring_run *run = (struct ring_run *) args;
+	struct info_t orders[BENCH_BATCH];
+	long i = 0;
+	int n, added;
+
+	while(i < run->numOrders){
+		for(n = 0; n < run->batch && i + n < run->numOrders; n++)
+			init_newOrder(&orders[n], (int) (i + n), NULL, i + n, i + n);
+		added = 0;
+		while(added < n){
+			added += tryPushOrders(run->ring, orders + added, n - added);
+			if(added < n)
+				waitForSpace(run->ring, &run->policy);
+		}
+		i += n;
+	}
+	closeOrderBuffer(run->ring);
+	return NULL;
+}
+
+void *ringConsumer(void *args){
+	struct ring_run *run = (struct ring_run *) args;
+	struct info_t orders[BENCH_BATCH];
+	int n, i, step = 0;
+
+	while(1){
+		n = tryPopOrders(run->ring, orders, run->batch);
+		if(n == 0){
+			if(orderBufferDrained(run->ring))
+				return NULL;
+			//consumers never park on the ring, in the program the pool runs them again later
+			if(!backoff(&run->policy, &step))
+				sched_yield();
+			continue;
+		}
+		step = 0;
+		for(i = 0; i < n; i++)
+			run->checksum += orders[i].bookprice;
+	}
+}
+
+void runPair(const char *name, struct ring_run *run, void *(*producer)(void *), void *(*consumer)(void *)){
+	struct bench_clock clock;
+	pthread_t ptid, ctid;
+	double wall, cpu;
+
+	run->checksum = 0;
+	startClock(&clock);
+	pthread_create(&ctid, NULL, consumer, run);
+	pthread_create(&ptid, NULL, producer, run);
+	pthread_join(ptid, NULL);
+	pthread_join(ctid, NULL);
+	wall = wallSeconds(&clock);
+	cpu = cpuSeconds(&clock);
+
+	if(run->checksum != run->numOrders * (run->numOrders - 1) / 2){
+		fprintf(stderr, "%s lost orders\n", name);
+		exit(1);
+	}
+	printf("  %-24s %8.2f M orders/s   %6.1f ns/order   cpu %5.2f s\n", name,
+		run->numOrders / wall / 1e6, wall * 1e9 / run->numOrders, cpu);
+}
+
+void runCapacity(long numOrders, int capacity){
+	struct ring_run run;
+
+	run.numOrders = numOrders;
+	initWaitPolicy(&run.policy);
+	printf("capacity %d\n", capacity);
+
+	run.locked.buf = (struct info_t *) malloc(capacity * sizeof(struct info_t));
+	run.locked.size = capacity;
+	run.locked.count = run.locked.front = run.locked.rear = run.locked.closed = 0;
+	pthread_mutex_init(&run.locked.mutex, NULL);
+	pthread_cond_init(&run.locked.dataAvailable, NULL);
+	pthread_cond_init(&run.locked.spaceAvailable, NULL);
+	runPair("mutex/condvar ring", &run, lockedProducer, lockedConsumer);
+	pthread_mutex_destroy(&run.locked.mutex);
+	pthread_cond_destroy(&run.locked.dataAvailable);
+	pthread_cond_destroy(&run.locked.spaceAvailable);
+	free(run.locked.buf);
+
+	run.ring = (orderBufferPtr) aligned_alloc(CACHE_LINE, sizeof(struct orders_struct));
+	init_order_buf(run.ring, capacity);
+	run.batch = 1;
+	runPair("lock free ring", &run, ringProducer, ringConsumer);
+	kill_order_buf(run.ring);
+
+	run.ring = (orderBufferPtr) aligned_alloc(CACHE_LINE, sizeof(struct orders_struct));
+	init_order_buf(run.ring, capacity);
+	run.batch = BENCH_BATCH;
+	runPair("lock free ring, batched", &run, ringProducer, ringConsumer);
+	kill_order_buf(run.ring);
+}
+
+int main(int argc, char **argv){
+	long numOrders = argOr(argc, argv, 1, 2000000);
+
+	printf("ring: %ld orders, one producer and one consumer\n", numOrders);
+	if(argc > 2){
+		runCapacity(numOrders, argOr(argc, argv, 2, 10));
+	}
+	else{
+		runCapacity(numOrders, 10); //MAXBUFSIZE
+		runCapacity(numOrders, BIG_CAPACITY);
+	}
+	return 0;
+}
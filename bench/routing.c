@@ -0,0 +1,119 @@
+#include "bench.h"
+#include "intern.h"
+#include "perfecthash.h"
+#include "uthash.h"
+
+/*
+ * Cost of routing an order to its category
+ *
+ * The perfect hash the producers look categories up in, against the uthash
+ * table keyed by category name they used before. Lookups are category fields
+ * as the tokenizer hands them out, pointing into a line and not null
+ * terminated, and one in ten names a category that does not exist.
+ *
+ * usage: routing [lookups] [categories ...]
+ */
+
+#define UNKNOWN_EVERY 10 //one lookup in this many is for an unknown category
+
+//an entry of the old category hash
+struct categoryHash{
+	char *category_key;
+	int shard;
+	UT_hash_handle hh;
+};
+typedef struct categoryHash * categoryHashPtr;
+
+void runCategories(int numCategories, long numLookups){
+	struct string_pool pool;
+	struct perfect_hash router;
+	internedPtr *names;
+	categoryHashPtr hash = NULL, entry, tmp;
+	struct bench_clock clock;
+	uint32_t seed = 2463534242u;
+	char name[32], *text, **starts;
+	int *lengths;
+	double perfect, chained;
+	long i, foundPerfect = 0, foundHash = 0;
+	size_t used = 0;
+	int n;
+
+	initPool(&pool);
+	names = (internedPtr *) malloc(numCategories * sizeof(internedPtr));
+	for(i = 0; i < numCategories; i++){
+		n = snprintf(name, sizeof(name), "CATEGORY%02ld", i);
+		names[i] = intern(&pool, name, n);
+		entry = (categoryHashPtr) malloc(sizeof(struct categoryHash));
+		entry->category_key = names[i]->text;
+		entry->shard = i;
+		HASH_ADD_KEYPTR(hh, hash, entry->category_key, names[i]->length, entry);
+	}
+	startClock(&clock);
+	if(buildPerfectHash(&router, names, numCategories) < 0){
+		fprintf(stderr, "no perfect hash for %d categories\n", numCategories);
+		exit(1);
+	}
+	printf("  %5d categories   perfect hash built in %8.1f us\n", numCategories, wallSeconds(&clock) * 1e6);
+
+	//every field is followed by a newline, as it would be at the end of an order
+	text = (char *) malloc(numLookups * sizeof(name));
+	starts = (char **) malloc(numLookups * sizeof(char *));
+	lengths = (int *) malloc(numLookups * sizeof(int));
+	for(i = 0; i < numLookups; i++){
+		if(i % UNKNOWN_EVERY == UNKNOWN_EVERY - 1)
+			n = snprintf(name, sizeof(name), "UNKNOWN%02u\n", benchRandom(&seed) % numCategories);
+		else
+			n = snprintf(name, sizeof(name), "CATEGORY%02u\n", benchRandom(&seed) % numCategories);
+		starts[i] = text + used;
+		lengths[i] = n - 1;
+		memcpy(text + used, name, n);
+		used += n;
+	}
+
+	startClock(&clock);
+	for(i = 0; i < numLookups; i++)
+		foundPerfect += (perfectLookup(&router, starts[i], lengths[i]) != NULL);
+	perfect = wallSeconds(&clock);
+
+	startClock(&clock);
+	for(i = 0; i < numLookups; i++){
+		HASH_FIND(hh, hash, starts[i], lengths[i], entry);
+		foundHash += (entry != NULL);
+	}
+	chained = wallSeconds(&clock);
+
+	if(foundPerfect != foundHash){
+		fprintf(stderr, "the tables disagree\n");
+		exit(1);
+	}
+	printf("  %5d categories   perfect hash %6.1f ns   uthash %6.1f ns per order\n", numCategories,
+		perfect * 1e9 / numLookups, chained * 1e9 / numLookups);
+
+	HASH_ITER(hh, hash, entry, tmp){
+		HASH_DEL(hash, entry);
+		free(entry);
+	}
+	freePerfectHash(&router);
+	destroyPool(&pool);
+	free(names);
+	free(text);
+	free(starts);
+	free(lengths);
+}
+
+int main(int argc, char **argv){
+	long numLookups = argOr(argc, argv, 1, 4000000);
+	int defaults[] = { 3, 60, 1000, 5000 };
+	int i;
+
+	printf("routing: %ld lookups, one in %d for an unknown category\n", numLookups, UNKNOWN_EVERY);
+	if(argc > 2){
+		for(i = 2; i < argc; i++)
+			runCategories(argOr(argc, argv, i, 3), numLookups);
+	}
+	else{
+		for(i = 0; i < (int) (sizeof(defaults) / sizeof(defaults[0])); i++)
+			runCategories(defaults[i], numLookups);
+	}
+	return 0;
+}
@@ -0,0 +1,167 @@
+#include <string.h>
+#include "bench.h"
+#include "tokenizer.h"
+
+/*
+ * Per line cost of splitting records on '|'
+ *
+ * Lines shaped like orders.txt and database.txt are split and parsed with the
+ * view API the producers and setup use, only split with it, split with the
+ * allocating TKCreate/TKGetNextToken API, and split by a plain byte at a time
+ * loop for reference.
+ *
+ * usage: tokenize [lines] [rounds]
+ */
+
+#if defined(__SSE2__)
+#define SCANNER "SSE2"
+#else
+#define SCANNER "scalar"
+#endif
+
+//numLines lines, each followed by its own null so TKCreate can take it as is
+struct line_set{
+	char *text;
+	char **lines;
+	int *lengths;
+	int numLines;
+};
+
+void makeLines(struct line_set *set, int numLines, int database){
+	uint32_t seed = 2463534242u;
+	char line[256];
+	size_t used = 0;
+	int i, length, id;
+
+	set->text = (char *) malloc((size_t) numLines * sizeof(line));
+	set->lines = (char **) malloc(numLines * sizeof(char *));
+	set->lengths = (int *) malloc(numLines * sizeof(int));
+	set->numLines = numLines;
+	for(i = 0; i < numLines; i++){
+		id = benchRandom(&seed) % 100000 + 1;
+		if(database)
+			length = snprintf(line, sizeof(line), "\"Name %d\"|%d|%u.%02u|\"%d Main St\"|\"NJ\"|\"%05d\"\n",
+				id, id, benchRandom(&seed) % 10000, benchRandom(&seed) % 100, id, id % 100000);
+		else
+			length = snprintf(line, sizeof(line), "\"Book %u: The Sequel, part %u\"|%u.%02u|%d|CATEGORY%02u\n",
+				benchRandom(&seed) % 200, benchRandom(&seed) % 600, benchRandom(&seed) % 100,
+				benchRandom(&seed) % 100, id, benchRandom(&seed) % 60);
+		set->lines[i] = set->text + used;
+		set->lengths[i] = length;
+		memcpy(set->text + used, line, length + 1);
+		used += length + 1;
+	}
+}
+
+void freeLines(struct line_set *set){
+	free(set->text);
+	free(set->lines);
+	free(set->lengths);
+}
+
+//splits every line, and converts every field the way parseOrders and setup do if convert is set
+//returns a checksum so nothing is optimized away
+long parseViews(struct line_set *set, int database, int convert){
+	TokenizerT tk;
+	TokenViewT field;
+	long sum = 0;
+	int i, f;
+
+	TKInitView(&tk, "|");
+	for(i = 0; i < set->numLines; i++){
+		TKSetText(&tk, set->lines[i], set->lengths[i]);
+		for(f = 0; TKGetNextView(&tk, &field); f++){
+			if(!convert){
+				sum += field.length;
+				continue;
+			}
+			TKTrimView(&field);
+			if((database && f == 1) || (!database && f == 2))
+				sum += TKViewToInt(&field);
+			else if((database && f == 2) || (!database && f == 1))
+				sum += TKViewToCents(&field);
+			else
+				sum += field.length;
+		}
+	}
+	return sum;
+}
+
+//the allocating API, every token is a new string
+long parseTokens(struct line_set *set){
+	TokenizerT *tk;
+	char *token;
+	long sum = 0;
+	int i;
+
+	for(i = 0; i < set->numLines; i++){
+		tk = TKCreate("|", set->lines[i]);
+		while((token = TKGetNextToken(tk)) != NULL){
+			sum += strlen(token);
+			free(token);
+		}
+		TKDestroy(tk);
+	}
+	return sum;
+}
+
+//splits by looking at one byte at a time, what the vector scanner replaces
+long parseBytes(struct line_set *set){
+	long sum = 0;
+	int i, j;
+
+	for(i = 0; i < set->numLines; i++){
+		for(j = 0; j < set->lengths[i]; j++){
+			if(set->lines[i][j] == '|' || set->lines[i][j] == '\n')
+				sum += j;
+		}
+	}
+	return sum;
+}
+
+void runRecords(const char *name, int database, int numLines, int rounds){
+	struct line_set set;
+	struct bench_clock clock;
+	volatile long sink = 0;
+	double parsed, split, tokens, bytes;
+	int r;
+
+	makeLines(&set, numLines, database);
+
+	startClock(&clock);
+	for(r = 0; r < rounds; r++)
+		sink += parseViews(&set, database, 1);
+	parsed = wallSeconds(&clock);
+
+	startClock(&clock);
+	for(r = 0; r < rounds; r++)
+		sink += parseViews(&set, database, 0);
+	split = wallSeconds(&clock);
+
+	startClock(&clock);
+	for(r = 0; r < rounds; r++)
+		sink += parseTokens(&set);
+	tokens = wallSeconds(&clock);
+
+	startClock(&clock);
+	for(r = 0; r < rounds; r++)
+		sink += parseBytes(&set);
+	bytes = wallSeconds(&clock);
+
+	//nanoseconds per line
+	printf("%-9s parsed %6.1f   split %6.1f   TKGetNextToken %6.1f   byte loop split %6.1f ns/line\n", name,
+		parsed * 1e9 / ((double) numLines * rounds), split * 1e9 / ((double) numLines * rounds),
+		tokens * 1e9 / ((double) numLines * rounds), bytes * 1e9 / ((double) numLines * rounds));
+	(void) sink;
+	freeLines(&set);
+}
+
+int main(int argc, char **argv){
+	int numLines = argOr(argc, argv, 1, 100000);
+	int rounds = argOr(argc, argv, 2, 10);
+
+	printf("tokenize: %d lines x %d rounds, %s scanner\n", numLines, rounds, SCANNER);
+	runRecords("orders", 0, numLines, rounds);
+	runRecords("database", 1, numLines, rounds);
+	return 0;
+}
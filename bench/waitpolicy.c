@@ -0,0 +1,155 @@
+#include <pthread.h>
+#include <unistd.h>
+#include "bench.h"
+#include "order.h"
+#include "thread.h"
+#include "workpool.h"
+
+/*
+ * Latency and cpu cost of each wait policy
+ *
+ * Orders go through a small ring to a one worker pool the way they do in the
+ * program: the producer waits for space with waitForSpace and schedules the
+ * category, the worker drains it and looks for more work as the policy says
+ * before it sleeps. Every order carries the time it was added, the worker
+ * records how long it waited in the ring.
+ *
+ * Each policy runs twice: saturated, the producer adds orders as fast as it can,
+ * and paced, the producer pauses after every few orders so that the worker
+ * keeps running out of work, which is where the policy matters.
+ *
+ * usage: waitpolicy [orders] [spins,yields ...]
+ */
+
+#define BENCH_CAPACITY 16
+#define BENCH_BATCH ORDER_BATCH //orders the worker takes at once, as runCategory does
+#define PACED_BURST 8 //orders between pauses when paced
+#define PACED_PAUSE 20000 //nanoseconds
+
+struct category_run{
+	orderBufferPtr ring;
+	atomic_int scheduled;
+	int64_t *latencies; //of every order taken, in nanoseconds
+	long numTaken;
+	int finished;
+	pthread_mutex_t lock;
+	pthread_cond_t done;
+};
+
+struct worker_pool pool;
+
+void scheduleRun(struct category_run *run){
+	int idle = 0;
+
+	if(atomic_load(&run->scheduled) == 0 && atomic_compare_exchange_strong(&run->scheduled, &idle, 1))
+		submitTask(&pool, run);
+}
+
+//the task the worker runs, drains the ring as runCategory does
+void drainRun(void *task){
+	struct category_run *run = (struct category_run *) task;
+	struct info_t orders[BENCH_BATCH];
+	int64_t now;
+	int n, i;
+
+	while((n = tryPopOrders(run->ring, orders, BENCH_BATCH)) > 0){
+		now = nowNanos();
+		for(i = 0; i < n; i++)
+			run->latencies[run->numTaken++] = now - orders[i].bookprice;
+	}
+	if(orderBufferDrained(run->ring)){
+		pthread_mutex_lock(&run->lock);
+		run->finished = 1;
+		pthread_cond_signal(&run->done);
+		pthread_mutex_unlock(&run->lock);
+		return;
+	}
+	atomic_store(&run->scheduled, 0);
+	if(orderBufferReady(run->ring))
+		scheduleRun(run);
+}
+
+int compareLatencies(const void *a, const void *b){
+	int64_t x = *(const int64_t *) a, y = *(const int64_t *) b;
+
+	return (x > y) - (x < y);
+}
+
+void runPolicy(FILE *results, const char *name, struct wait_policy *policy, long numOrders, int paced){
+	struct category_run run;
+	struct bench_clock clock;
+	struct timespec pause = { 0, PACED_PAUSE };
+	struct info_t order;
+	double wall, cpu, mean = 0;
+	long i;
+
+	run.ring = (orderBufferPtr) aligned_alloc(CACHE_LINE, sizeof(struct orders_struct));
+	init_order_buf(run.ring, BENCH_CAPACITY);
+	atomic_init(&run.scheduled, 0);
+	run.latencies = (int64_t *) malloc(numOrders * sizeof(int64_t));
+	run.numTaken = 0;
+	run.finished = 0;
+	pthread_mutex_init(&run.lock, NULL);
+	pthread_cond_init(&run.done, NULL);
+	startWorkers(&pool, 1, 1, drainRun, policy);
+
+	startClock(&clock);
+	for(i = 0; i < numOrders; i++){
+		init_newOrder(&order, (int) i, NULL, nowNanos(), i);
+		while(!tryPushOrder(run.ring, &order))
+			waitForSpace(run.ring, policy);
+		scheduleRun(&run);
+		if(paced && i % PACED_BURST == PACED_BURST - 1)
+			nanosleep(&pause, NULL);
+	}
+	closeOrderBuffer(run.ring);
+	scheduleRun(&run);
+	pthread_mutex_lock(&run.lock);
+	while(!run.finished)
+		pthread_cond_wait(&run.done, &run.lock);
+	pthread_mutex_unlock(&run.lock);
+	wall = wallSeconds(&clock);
+	cpu = cpuSeconds(&clock);
+	stopWorkers(&pool);
+
+	for(i = 0; i < run.numTaken; i++)
+		mean += run.latencies[i];
+	mean /= run.numTaken;
+	qsort(run.latencies, run.numTaken, sizeof(int64_t), compareLatencies);
+	fprintf(results, "  %-10s %-9s latency mean %8.0f  p50 %8lld  p99 %9lld ns   cpu %5.2f s of %5.2f s wall (%3.0f%%)\n",
+		name, paced ? "paced" : "saturated", mean, (long long) run.latencies[run.numTaken / 2],
+		(long long) run.latencies[run.numTaken * 99 / 100], cpu, wall, 100 * cpu / wall);
+	fflush(results);
+
+	pthread_mutex_destroy(&run.lock);
+	pthread_cond_destroy(&run.done);
+	free(run.latencies);
+	kill_order_buf(run.ring);
+}
+
+int main(int argc, char **argv){
+	long numOrders = argOr(argc, argv, 1, 200000);
+	const char *defaults[] = { "0,0", "0,8", "128,8", "4096,64" };
+	struct wait_policy policy;
+	FILE *results;
+	int i, numPolicies = (argc > 2) ? argc - 2 : (int) (sizeof(defaults) / sizeof(defaults[0]));
+	const char *name;
+
+	//the pool's workers log every sleep to stdout, results get a stream of their own
+	results = fdopen(dup(STDOUT_FILENO), "w");
+	freopen("/dev/null", "w", stdout);
+
+	fprintf(results, "waitpolicy: %ld orders, capacity %d, %ld cpus, policies are -y spins,yields\n",
+		numOrders, BENCH_CAPACITY, sysconf(_SC_NPROCESSORS_ONLN));
+	for(i = 0; i < numPolicies; i++){
+		name = (argc > 2) ? argv[i + 2] : defaults[i];
+		if(parseWaitPolicy(name, &policy) < 0){
+			fprintf(stderr, "%s is not a wait policy, expected spins[,yields]\n", name);
+			return 1;
+		}
+		runPolicy(results, name, &policy, numOrders, 0);
+		runPolicy(results, name, &policy, numOrders, 1);
+	}
+	fclose(results);
+	return 0;
+}
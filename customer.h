@@ -4,6 +4,17 @@
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
+#include <stdint.h>
+#include <stdatomic.h>
+
+//balances are debited with a compare and swap where 64 bit atomics are lock free,
+//otherwise (or when built with -DLOCKED_BALANCES) under the customer's lock
+#if ATOMIC_LLONG_LOCK_FREE == 2 && !defined(LOCKED_BALANCES)
+#define ATOMIC_BALANCES
+typedef _Atomic int64_t balance_t;
+#else
+typedef int64_t balance_t;
+#endif
 
 //template for a customer item
 
@@ -12,7 +23,7 @@ struct CustomerStruct{
 	char * address;
 	char * state;
 	char * zip;
-	float balance;
+	balance_t balance; //in cents
 };
 typedef struct CustomerStruct * customerPtr;
 
@@ -0,0 +1,224 @@
+#include "custtable.h"
+#include "order.h"
+
+//Fibonacci hashing: the multiply spreads consecutive ids over the whole table
+unsigned int homeSlot(customerTablePtr table, int customerID){
+	return ((uint32_t) customerID * 2654435769u) >> table->shift;
+}
+
+//allocates numSlots empty slots, numSlots is a power of 2
+void allocSlots(customerTablePtr table, unsigned int numSlots){
+	table->slots = (customerSlotPtr) calloc(numSlots, sizeof(struct customer_slot));
+	table->numSlots = numSlots;
+	table->shift = 32;
+	while(numSlots > 1){
+		table->shift--;
+		numSlots >>= 1;
+	}
+}
+
+//places a customer whose id is known not to be in the table yet
+void placeCustomer(customerTablePtr table, struct customer_slot entry){
+	struct customer_slot displaced;
+	unsigned int mask = table->numSlots - 1;
+	unsigned int i = homeSlot(table, entry.customer_id);
+
+	entry.probe = 1;
+	while(table->slots[i].probe != 0){
+		//the occupant is closer to its home slot, it moves on and entry stays here
+		if(table->slots[i].probe < entry.probe){
+			displaced = table->slots[i];
+			table->slots[i] = entry;
+			entry = displaced;
+		}
+		i = (i + 1) & mask;
+		entry.probe++;
+	}
+	table->slots[i] = entry;
+	table->count++;
+}
+
+//slots a hashed table needs for count customers, it is kept at most 7/8 full
+unsigned int slotsFor(unsigned int count){
+	unsigned int numSlots = TABLE_MIN_SLOTS;
+
+	while(numSlots / 8 * 7 < count)
+		numSlots *= 2;
+	return numSlots;
+}
+
+//places every customer again in a hashed table of numSlots slots
+void rehashTable(customerTablePtr table, unsigned int numSlots){
+	customerSlotPtr old = table->slots;
+	unsigned int oldSlots = table->numSlots;
+	unsigned int i;
+
+	allocSlots(table, numSlots);
+	table->count = 0;
+	table->dense = 0;
+	for(i = 0; i < oldSlots; i++){
+		if(old[i].probe != 0)
+			placeCustomer(table, old[i]);
+	}
+	free(old);
+}
+
+//lays the slots out by id - minId if the ids span few enough slots
+void makeDense(customerTablePtr table){
+	customerSlotPtr dense;
+	int minId = 0, maxId = 0, found = 0;
+	int64_t span;
+	unsigned int i;
+
+	for(i = 0; i < table->numSlots; i++){
+		if(table->slots[i].probe == 0)
+			continue;
+		if(!found || table->slots[i].customer_id < minId)
+			minId = table->slots[i].customer_id;
+		if(!found || table->slots[i].customer_id > maxId)
+			maxId = table->slots[i].customer_id;
+		found = 1;
+	}
+	if(!found)
+		return;
+	span = (int64_t) maxId - minId + 1;
+	if(span > (int64_t) table->count * DENSE_MAX_SPAN)
+		return;
+
+	dense = (customerSlotPtr) calloc(span, sizeof(struct customer_slot));
+	for(i = 0; i < table->numSlots; i++){
+		if(table->slots[i].probe != 0){
+			dense[table->slots[i].customer_id - minId] = table->slots[i];
+			dense[table->slots[i].customer_id - minId].probe = 1;
+		}
+	}
+	free(table->slots);
+	table->slots = dense;
+	table->numSlots = span;
+	table->minId = minId;
+	table->dense = 1;
+}
+
+void initCustomerTable(customerTablePtr table, unsigned int expected){
+	allocSlots(table, slotsFor(expected));
+	table->count = 0;
+	table->dense = 0;
+	table->minId = 0;
+	table->byId = NULL;
+}
+
+void clearCustomerTable(customerTablePtr table){
+	free(table->slots);
+	free(table->byId);
+	table->slots = NULL;
+	table->byId = NULL;
+	table->numSlots = table->count = 0;
+}
+
+int addCustomer(customerTablePtr table, int customerID, customerPtr newCustomer){
+	struct customer_slot entry;
+
+	//check uniqueness of key
+	if(getCustomer(table, customerID) != NULL)
+		return 1;
+
+	//a finished dense table goes back to hashing, the new id may be anywhere
+	if(table->dense)
+		rehashTable(table, slotsFor(table->count + 1));
+	else if(table->count + 1 > table->numSlots / 8 * 7)
+		rehashTable(table, table->numSlots * 2);
+
+	memset(&entry, 0, sizeof(entry));
+	entry.customer_id = customerID;
+	entry.customer = *newCustomer;
+	placeCustomer(table, entry);
+
+	//the order is rebuilt once the table is complete
+	free(table->byId);
+	table->byId = NULL;
+	return 0;
+}
+
+customerPtr getCustomer(customerTablePtr table, int customerID){
+	unsigned int mask = table->numSlots - 1;
+	unsigned int i;
+	int probe;
+
+	if(table->slots == NULL)
+		return NULL;
+
+	//the id is its own index, no hashing and no probing
+	if(table->dense){
+		i = (unsigned int) customerID - (unsigned int) table->minId;
+		if(i < table->numSlots && table->slots[i].probe != 0)
+			return &table->slots[i].customer;
+		return NULL;
+	}
+
+	//an empty slot, or one closer to its home than this id would be, ends the search
+	i = homeSlot(table, customerID);
+	for(probe = 1; table->slots[i].probe >= probe; probe++){
+		if(table->slots[i].customer_id == customerID)
+			return &table->slots[i].customer;
+		i = (i + 1) & mask;
+	}
+	return NULL;
+}
+
+//the table finishCustomerTable is ordering, qsort gives no way to pass it along
+_Thread_local customerTablePtr sortingTable;
+
+int compareSlotsById(const void *a, const void *b){
+	int idA = sortingTable->slots[*(const unsigned int *) a].customer_id;
+	int idB = sortingTable->slots[*(const unsigned int *) b].customer_id;
+
+	return (idA > idB) - (idA < idB);
+}
+
+void finishCustomerTable(customerTablePtr table){
+	unsigned int i, n = 0;
+
+	if(!table->dense)
+		makeDense(table);
+
+	free(table->byId);
+	table->byId = (unsigned int *) malloc((table->count ? table->count : 1) * sizeof(unsigned int));
+	for(i = 0; i < table->numSlots; i++){
+		if(table->slots[i].probe != 0)
+			table->byId[n++] = i;
+	}
+
+	//a dense table's slots are already in order of id
+	if(!table->dense){
+		sortingTable = table;
+		qsort(table->byId, n, sizeof(unsigned int), compareSlotsById);
+		sortingTable = NULL;
+	}
+}
+
+customerSlotPtr customerByRank(customerTablePtr table, unsigned int i){
+	return &table->slots[table->byId[i]];
+}
+
+/**
+ * Debugging function
+ */
+
+void printCustomerTable(customerTablePtr table){
+	customerSlotPtr printer;
+	char amount[CENTS_STRLEN];
+	unsigned int i;
+
+	for(i = 0; i < table->numSlots; i++){
+		printer = &table->slots[i];
+		if(printer->probe == 0)
+			continue;
+		printf("Customer ID: %d\n", printer->customer_id);
+		printf("\tName: %s\n", printer->customer.name);
+		printf("\tAddress: %s\n", printer->customer.address);
+		printf("\tState: %s\n", printer->customer.state);
+		printf("\tZip: %s\n", printer->customer.zip);
+		formatCents(printer->customer.balance, amount);
+		printf("\tBalance: %s\n", amount);
+	}
+}
@@ -0,0 +1,74 @@
+#ifndef CUSTTABLE_H
+#define CUSTTABLE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "customer.h"
+
+/*
+ * Flat customer table
+ *
+ * Open addressing with Robin Hood probing, keyed by customer id. Customers are
+ * stored inside the slots, balance included, so a lookup reads one run of
+ * neighbouring slots and no pointers. Every slot remembers how far it is from
+ * the slot its id hashes to; an insert that has probed further than a slot's
+ * occupant takes the slot and carries the occupant on, which keeps every probe
+ * sequence short and lets a lookup stop as soon as it passes where its id
+ * would have been placed.
+ *
+ * When the table is finished and the ids turn out to be compact, the slots are
+ * laid out again as a plain array indexed by id - minId, a lookup then is a
+ * bounds check and one load. Sparse ids keep the hashed layout.
+ *
+ * The table is built by one thread, then only read: lookups take no lock and
+ * consumers change nothing but the balances. Adding customers may move every
+ * slot, customer pointers are only stable once the table is finished.
+ */
+
+#define TABLE_MIN_SLOTS 64 //a power of 2
+#define DENSE_MAX_SPAN 2 //ids are indexed directly when they span at most this many slots per customer
+
+struct customer_slot{
+	int customer_id;
+	int probe; //slots past the one the id hashes to, plus 1, 0 for an empty slot, always 1 in a dense table
+	struct CustomerStruct customer;
+};
+typedef struct customer_slot * customerSlotPtr;
+
+struct customer_table{
+	customerSlotPtr slots;
+	unsigned int numSlots; //a power of 2 unless dense
+	unsigned int count;
+	int shift; //32 - log2(numSlots), the id's hash is taken from its top bits
+	int dense; //slots are indexed by id - minId instead of hashed
+	int minId;
+	unsigned int *byId; //slot of every customer in order of id, filled by finishCustomerTable
+};
+typedef struct customer_table * customerTablePtr;
+
+// Sets up an empty table sized for about expected customers
+void initCustomerTable(customerTablePtr table, unsigned int expected);
+
+// Frees the table, the customers' strings belong to whoever allocated them
+void clearCustomerTable(customerTablePtr table);
+
+// Copies the customer into the table under customerID, its strings are shared not copied
+// returns 0 on success, 1 if the id is already in the table and nothing was added
+int addCustomer(customerTablePtr table, int customerID, customerPtr newCustomer);
+
+//returns the customer info or null if customer doesnt exist
+customerPtr getCustomer(customerTablePtr table, int customerID);
+
+// Called once every customer is added: switches to direct indexing if the ids are compact
+// and lists the customers in order of id for reports and snapshots
+void finishCustomerTable(customerTablePtr table);
+
+// The customer with the i-th smallest id, valid after finishCustomerTable
+customerSlotPtr customerByRank(customerTablePtr table, unsigned int i);
+
+//debugging function
+void printCustomerTable(customerTablePtr table);
+
+#endif
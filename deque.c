@@ -0,0 +1,67 @@
+#include "deque.h"
+
+void initDeque(dequePtr dq, int capacity){
+	long size = 1;
+
+	while(size < capacity)
+		size <<= 1;
+	dq->items = calloc(size, sizeof(*dq->items));
+	dq->mask = size - 1;
+	atomic_init(&dq->top, 0);
+	atomic_init(&dq->bottom, 0);
+}
+
+void destroyDeque(dequePtr dq){
+	free(dq->items);
+	dq->items = NULL;
+}
+
+void dequePush(dequePtr dq, void *item){
+	long bottom = atomic_load_explicit(&dq->bottom, memory_order_relaxed);
+
+	atomic_store_explicit(&dq->items[bottom & dq->mask], item, memory_order_relaxed);
+	//the item has to be in place before a thief can see the new bottom
+	atomic_thread_fence(memory_order_release);
+	atomic_store_explicit(&dq->bottom, bottom + 1, memory_order_relaxed);
+}
+
+void *dequeTake(dequePtr dq){
+	long bottom = atomic_load_explicit(&dq->bottom, memory_order_relaxed) - 1;
+	long top;
+	void *item = NULL;
+
+	//claim the bottom item first, then see whether a thief got there
+	atomic_store_explicit(&dq->bottom, bottom, memory_order_relaxed);
+	atomic_thread_fence(memory_order_seq_cst);
+	top = atomic_load_explicit(&dq->top, memory_order_relaxed);
+
+	if(top <= bottom){
+		item = atomic_load_explicit(&dq->items[bottom & dq->mask], memory_order_relaxed);
+		if(top == bottom){
+			//last item, whoever moves top first gets it
+			if(!atomic_compare_exchange_strong_explicit(&dq->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+				item = NULL;
+			atomic_store_explicit(&dq->bottom, bottom + 1, memory_order_relaxed);
+		}
+	}
+	else{
+		atomic_store_explicit(&dq->bottom, bottom + 1, memory_order_relaxed);
+	}
+	return item;
+}
+
+void *dequeSteal(dequePtr dq){
+	long top = atomic_load_explicit(&dq->top, memory_order_acquire);
+	long bottom;
+	void *item;
+
+	atomic_thread_fence(memory_order_seq_cst);
+	bottom = atomic_load_explicit(&dq->bottom, memory_order_acquire);
+	if(top >= bottom)
+		return NULL;
+
+	item = atomic_load_explicit(&dq->items[top & dq->mask], memory_order_relaxed);
+	if(!atomic_compare_exchange_strong_explicit(&dq->top, &top, top + 1, memory_order_seq_cst, memory_order_relaxed))
+		return NULL;
+	return item;
+}
@@ -0,0 +1,45 @@
+#ifndef DEQUE_H
+#define DEQUE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdatomic.h>
+
+/*
+ * Work-stealing deque (Chase-Lev)
+ *
+ * The owning thread pushes and takes items at the bottom, any other thread may
+ * steal the oldest item from the top. The owner's push and take need no lock,
+ * a steal and the owner's take only race for the last item and settle it with a
+ * compare and swap on top.
+ *
+ * The capacity is fixed when the deque is created, callers make sure it is never
+ * exceeded.
+ */
+
+struct work_deque{
+	_Atomic(void *) *items;
+	long mask; //capacity-1, the capacity is a power of 2
+	atomic_long top; //next item to steal
+	atomic_long bottom; //next free slot for the owner
+};
+typedef struct work_deque * dequePtr;
+
+// Sets up an empty deque that holds at least capacity items
+void initDeque(dequePtr dq, int capacity);
+
+// Frees the deque's items array, the items themselves are not touched
+void destroyDeque(dequePtr dq);
+
+// Owner only: adds an item at the bottom
+void dequePush(dequePtr dq, void *item);
+
+// Owner only: takes the newest item from the bottom
+// returns NULL if the deque is empty
+void *dequeTake(dequePtr dq);
+
+// Any thread: takes the oldest item from the top
+// returns NULL if the deque is empty or another thread won the item
+void *dequeSteal(dequePtr dq);
+
+#endif
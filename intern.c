@@ -0,0 +1,104 @@
+#include "intern.h"
+
+//FNV-1a, the low bits pick the stripe and the high bits pick the bucket
+uint64_t hashString(const char *text, int length){
+	uint64_t hash = 14695981039346656037ULL;
+	int i;
+
+	for(i = 0; i < length; i++){
+		hash ^= (unsigned char) text[i];
+		hash *= 1099511628211ULL;
+	}
+	return hash;
+}
+
+void initPool(stringPoolPtr pool){
+	int i;
+
+	for(i = 0; i < POOL_STRIPES; i++){
+		pthread_mutex_init(&pool->stripes[i].lock, NULL);
+		pool->stripes[i].buckets = (internedPtr *) calloc(POOL_INITIAL_BUCKETS, sizeof(internedPtr));
+		pool->stripes[i].numBuckets = POOL_INITIAL_BUCKETS;
+		pool->stripes[i].count = 0;
+		initArena(&pool->stripes[i].strings);
+	}
+	atomic_init(&pool->nextId, 0);
+}
+
+void destroyPool(stringPoolPtr pool){
+	int i;
+
+	for(i = 0; i < POOL_STRIPES; i++){
+		freeArena(&pool->stripes[i].strings);
+		free(pool->stripes[i].buckets);
+		pool->stripes[i].buckets = NULL;
+		pool->stripes[i].numBuckets = pool->stripes[i].count = 0;
+		pthread_mutex_destroy(&pool->stripes[i].lock);
+	}
+}
+
+//bucket of a hash within its stripe, skips the bits already used to pick the stripe
+int bucketIndex(uint64_t hash, int numBuckets){
+	return (hash >> 32) & (numBuckets - 1);
+}
+
+//looks for text in one stripe, the stripe must be locked
+internedPtr searchStripe(struct pool_stripe *stripe, const char *text, int length, uint64_t hash){
+	internedPtr current;
+
+	for(current = stripe->buckets[bucketIndex(hash, stripe->numBuckets)]; current != NULL; current = current->next){
+		if(current->hash == hash && current->length == length && memcmp(current->text, text, length) == 0)
+			return current;
+	}
+	return NULL;
+}
+
+//doubles the buckets of a stripe once it holds more strings than buckets, the stripe must be locked
+void growStripe(struct pool_stripe *stripe){
+	int numBuckets = stripe->numBuckets * 2;
+	internedPtr *buckets = (internedPtr *) calloc(numBuckets, sizeof(internedPtr));
+	internedPtr current, next;
+	int i, index;
+
+	for(i = 0; i < stripe->numBuckets; i++){
+		for(current = stripe->buckets[i]; current != NULL; current = next){
+			next = current->next;
+			index = bucketIndex(current->hash, numBuckets);
+			current->next = buckets[index];
+			buckets[index] = current;
+		}
+	}
+	free(stripe->buckets);
+	stripe->buckets = buckets;
+	stripe->numBuckets = numBuckets;
+}
+
+internedPtr intern(stringPoolPtr pool, const char *text, int length){
+	uint64_t hash = hashString(text, length);
+	struct pool_stripe *stripe = &pool->stripes[hash % POOL_STRIPES];
+	internedPtr found;
+	int index;
+
+	pthread_mutex_lock(&stripe->lock);
+	if((found = searchStripe(stripe, text, length, hash)) == NULL){
+		found = (internedPtr) arenaAlloc(&stripe->strings, sizeof(struct interned_string));
+		found->text = arenaDup(&stripe->strings, text, length);
+		found->length = length;
+		found->hash = hash;
+		found->id = atomic_fetch_add(&pool->nextId, 1);
+
+		if(stripe->count >= stripe->numBuckets)
+			growStripe(stripe);
+		index = bucketIndex(hash, stripe->numBuckets);
+		found->next = stripe->buckets[index];
+		stripe->buckets[index] = found;
+		stripe->count++;
+	}
+	pthread_mutex_unlock(&stripe->lock);
+
+	return found;
+}
+
+int poolSize(stringPoolPtr pool){
+	return atomic_load(&pool->nextId);
+}
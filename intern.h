@@ -0,0 +1,69 @@
+#ifndef INTERN_H
+#define INTERN_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "arena.h"
+
+/*
+ * String interning pool
+ *
+ * Every distinct string added to a pool is stored once and gets a stable id,
+ * ids are handed out densely from 0 in the order strings are first seen.
+ * Callers keep the returned interned_string pointer, so equal strings can be
+ * compared by pointer or id instead of by their characters.
+ *
+ * The pool is split into POOL_STRIPES independent hash tables chosen by the
+ * string's hash, each with its own lock, so threads adding different strings
+ * rarely wait on each other. Interned strings are never moved or freed until
+ * the pool is destroyed, each stripe allocates them from its own arena under
+ * its lock.
+ */
+
+#define POOL_STRIPES 64
+#define POOL_INITIAL_BUCKETS 64
+
+struct interned_string{
+	char *text; //null terminated copy
+	int length;
+	int id;
+	uint64_t hash;
+	struct interned_string *next; //next string in the same bucket
+};
+typedef struct interned_string * internedPtr;
+
+struct pool_stripe{
+	pthread_mutex_t lock;
+	internedPtr *buckets;
+	int numBuckets; //always a power of 2
+	int count;
+	struct arena strings; //the stripe's interned_strings and their text
+};
+
+struct string_pool{
+	struct pool_stripe stripes[POOL_STRIPES];
+	atomic_int nextId;
+};
+typedef struct string_pool * stringPoolPtr;
+
+// The hash strings are filed under, FNV-1a, kept in every interned_string
+uint64_t hashString(const char *text, int length);
+
+// Sets up an empty pool
+void initPool(stringPoolPtr pool);
+
+// Frees every interned string and the pool's tables
+void destroyPool(stringPoolPtr pool);
+
+// Returns the interned copy of text, adding it if the pool has not seen it yet
+// text does not need to be null terminated
+internedPtr intern(stringPoolPtr pool, const char *text, int length);
+
+// Number of distinct strings in the pool
+int poolSize(stringPoolPtr pool);
+
+#endif
@@ -0,0 +1,86 @@
+#include "mapfile.h"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+int mapFile(const char *path, mappedFilePtr mf, int copyOnWrite){
+	struct stat st;
+
+	mf->data = NULL;
+	mf->size = 0;
+	mf->copyOnWrite = copyOnWrite;
+
+	if((mf->fd = open(path, O_RDONLY)) < 0)
+		return -1;
+
+	if(fstat(mf->fd, &st) < 0){
+		close(mf->fd);
+		mf->fd = -1;
+		return -1;
+	}
+
+	//mmap refuses zero length mappings, an empty file is just an empty buffer
+	if(st.st_size == 0)
+		return 0;
+
+	mf->data = mmap(NULL, st.st_size, copyOnWrite ? PROT_READ|PROT_WRITE : PROT_READ, MAP_PRIVATE, mf->fd, 0);
+	if(mf->data == MAP_FAILED){
+		mf->data = NULL;
+		close(mf->fd);
+		mf->fd = -1;
+		return -1;
+	}
+	mf->size = st.st_size;
+
+	//the file is walked front to back exactly once, let the kernel read ahead
+	madvise(mf->data, mf->size, MADV_SEQUENTIAL);
+
+	return 0;
+}
+
+int remapFile(mappedFilePtr mf){
+	struct stat st;
+	char *data = NULL;
+
+	if(fstat(mf->fd, &st) < 0)
+		return -1;
+	if((size_t) st.st_size == mf->size)
+		return 0;
+
+	if(st.st_size > 0){
+		data = mmap(NULL, st.st_size, mf->copyOnWrite ? PROT_READ|PROT_WRITE : PROT_READ, MAP_PRIVATE, mf->fd, 0);
+		if(data == MAP_FAILED)
+			return -1;
+	}
+	if(mf->data != NULL)
+		munmap(mf->data, mf->size);
+	mf->data = data;
+	mf->size = st.st_size;
+
+	return 0;
+}
+
+void unmapFile(mappedFilePtr mf){
+	if(mf == NULL)
+		return;
+	if(mf->data != NULL)
+		munmap(mf->data, mf->size);
+	if(mf->fd >= 0)
+		close(mf->fd);
+	mf->data = NULL;
+	mf->size = 0;
+	mf->fd = -1;
+}
+
+char *nextLine(char *pos, char *end){
+	char *newline = memchr(pos, '\n', end - pos);
+
+	return (newline == NULL) ? end : newline + 1;
+}
+
+char *lastLineEnd(char *start, char *end){
+	while(end > start && end[-1] != '\n')
+		end--;
+	return end;
+}
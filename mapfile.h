@@ -0,0 +1,41 @@
+#ifndef MAPFILE_H
+#define MAPFILE_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/types.h>
+
+//a whole file mapped into memory
+//tokens handed out by the tokenizer's view API point straight into data,
+//so the mapping has to outlive every view taken from it
+struct mapped_file{
+	char *data; //NULL when the file is empty
+	size_t size;
+	int fd;
+	int copyOnWrite;
+};
+typedef struct mapped_file * mappedFilePtr;
+
+// Maps the whole file into memory, read only unless copyOnWrite is set in which
+// case writes go to private pages and never reach the file
+// returns 0 on success, -1 on failure with errno set
+int mapFile(const char *path, mappedFilePtr mf, int copyOnWrite);
+
+// Maps the file again if its size changed since it was mapped, for files that are still being written
+// data may move, pointers into the old mapping are no longer valid afterwards
+// returns 0 on success, -1 on failure with errno set
+int remapFile(mappedFilePtr mf);
+
+// Unmaps the file and closes it, safe to call on a file that was never mapped
+void unmapFile(mappedFilePtr mf);
+
+// Returns a pointer to the first character after the next newline at or after pos
+// or end if the rest of the buffer has no newline
+char *nextLine(char *pos, char *end);
+
+// Returns a pointer to the first character after the last newline between start and end
+// or start if there is no newline, everything before it is complete lines
+char *lastLineEnd(char *start, char *end);
+
+#endif
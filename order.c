@@ -1,83 +1,229 @@
 #include "order.h"
+#include <limits.h>
+#include <linux/futex.h>
+#include <sys/syscall.h>
 
-// creates a new customer object
-customerPtr createCustomer(char *name, char *add, char *zip, char *state, float bal){
-	customerPtr customerToAdd = (customerPtr) malloc(sizeof(struct CustomerStruct));
-
-	customerToAdd->name = name;
-	customerToAdd->address = add;
-	customerToAdd->state = state;
-	customerToAdd->zip = zip;
-	customerToAdd->balance = bal;
+//sleeps while *word still holds value, returns at once if it changed
+void futexWait(atomic_int *word, int value){
+	syscall(SYS_futex, word, FUTEX_WAIT_PRIVATE, value, NULL, NULL, 0);
+}
 
-	return customerToAdd;
+//wakes every thread sleeping on word
+void futexWake(atomic_int *word){
+	syscall(SYS_futex, word, FUTEX_WAKE_PRIVATE, INT_MAX, NULL, NULL, 0);
 }
 
-void killCustomer(customerPtr tempcust){
-	if(tempcust == NULL)
-		return;
-	else{
-		free(tempcust->name);
-		free(tempcust->address);
-		free(tempcust->state);
-		free(tempcust->zip);
-		free(tempcust);
+int debitBalance(customerPtr customer, int64_t amount, int64_t *remaining){
+#ifdef ATOMIC_BALANCES
+	int64_t balance = atomic_load_explicit(&customer->balance, memory_order_relaxed);
+
+	//retry until no other consumer changed the balance between the check and the swap,
+	//a failed swap reloads balance
+	do{
+		if(balance - amount < 0){
+			*remaining = balance;
+			return 0;
+		}
+	}while(!atomic_compare_exchange_weak_explicit(&customer->balance, &balance, balance - amount, memory_order_relaxed, memory_order_relaxed));
+	*remaining = balance - amount;
+	return 1;
+#else
+	if(customer->balance - amount < 0){
+		*remaining = customer->balance;
+		return 0;
 	}
+	customer->balance -= amount;
+	*remaining = customer->balance;
+	return 1;
+#endif
 }
 
 // given customer id, book, book price
-// return pointer to new order
-orderInfoPtr init_newOrder(int customer_ID, char* book_title, float book_price){
-	orderInfoPtr newOrder = (orderInfoPtr) malloc(sizeof(struct info_t));
-
+// fills in newOrder
+void init_newOrder(orderInfoPtr newOrder, int customer_ID, internedPtr book_title, int64_t book_price, long position){
 	newOrder->customer_id = customer_ID;
-	newOrder->book_name = book_title;
+	newOrder->title = book_title;
 	newOrder->bookprice = book_price;
-
-	return newOrder;
+	newOrder->position = position;
 }
 
 //initializes a buffer of orders
+//the buffer must come from aligned_alloc(CACHE_LINE, ...) for the padding to mean anything
 void init_order_buf(orderBufferPtr ob, int buf_size){
-    ob->buf = calloc(buf_size, sizeof(struct info_t));
-    ob->size = buf_size;
-    ob->count = 0;
-    ob->front = ob->rear = 0;
-    pthread_mutex_init(&ob->mutex, 0);
-    pthread_cond_init(&ob->dataAvailable, 0);
-    pthread_cond_init(&ob->spaceAvailable, 0);
+	unsigned int size = 1;
+
+	//a power of 2 so the never wrapped counters can be masked into slots
+	while(size < buf_size)
+		size <<= 1;
+	ob->buf = ob->consumerBuf = calloc(size, sizeof(struct info_t));
+	ob->size = ob->consumerSize = size;
+	ob->stalls = 0;
+	atomic_init(&ob->rear, 0);
+	atomic_init(&ob->front, 0);
+	ob->cachedFront = ob->cachedRear = 0;
+	atomic_init(&ob->nextBuf, NULL);
+	ob->nextSize = ob->switchAt = 0;
+	atomic_init(&ob->closed, 0);
+	atomic_init(&ob->spaceAvailable, 0);
+	atomic_init(&ob->producerWaiting, 0);
 }
 
 void kill_order_buf(orderBufferPtr ob){
 	if(ob == NULL)
 		return;
 	else{
-		pthread_mutex_destroy(&ob->mutex);
-		pthread_cond_destroy(&ob->dataAvailable);
-		pthread_cond_destroy(&ob->spaceAvailable);
+		//a grow the consumer never picked up leaves two arrays
+		if(ob->consumerBuf != ob->buf)
+			free(ob->consumerBuf);
 		free(ob->buf);
 		free(ob);
 	}
 }
 
-void free_order(orderInfoPtr order){
-	if(order == NULL)
+unsigned int growOrderBuffer(orderBufferPtr ob, int new_size){
+	unsigned int size = ob->size;
+	struct info_t *grown;
+
+	while(size < new_size)
+		size <<= 1;
+	if(size == ob->size || atomic_load_explicit(&ob->nextBuf, memory_order_acquire) != NULL)
+		return 0;
+
+	//orders before switchAt stay in the old array, the consumer still needs them
+	grown = calloc(size, sizeof(struct info_t));
+	ob->nextSize = size;
+	ob->switchAt = atomic_load_explicit(&ob->rear, memory_order_relaxed);
+	atomic_store_explicit(&ob->nextBuf, grown, memory_order_release);
+	ob->buf = grown;
+	ob->size = size;
+	return size;
+}
+
+//consumer side: moves to the grown array once every order left in the old one is taken
+void takeGrownBuffer(orderBufferPtr ob, unsigned int position){
+	struct info_t *grown = atomic_load_explicit(&ob->nextBuf, memory_order_acquire);
+
+	if(grown == NULL || position != ob->switchAt)
 		return;
-	else{
-		free(order->book_name);
-		free(order);
+	free(ob->consumerBuf);
+	ob->consumerBuf = grown;
+	ob->consumerSize = ob->nextSize;
+	atomic_store_explicit(&ob->nextBuf, NULL, memory_order_release);
+}
+
+int tryPushOrder(orderBufferPtr ob, const struct info_t *order){
+	return tryPushOrders(ob, order, 1);
+}
+
+int tryPushOrders(orderBufferPtr ob, const struct info_t *orders, int n){
+	unsigned int rear = atomic_load_explicit(&ob->rear, memory_order_relaxed);
+	unsigned int room = ob->size - (rear - ob->cachedFront);
+	int i;
+
+	if(room < n){
+		ob->cachedFront = atomic_load_explicit(&ob->front, memory_order_acquire);
+		room = ob->size - (rear - ob->cachedFront);
+		if(room == 0)
+			return 0;
+		if(room < n)
+			n = room;
 	}
+
+	for(i = 0; i < n; i++)
+		ob->buf[(rear + i) & (ob->size - 1)] = orders[i];
+	atomic_store_explicit(&ob->rear, rear + n, memory_order_release);
+
+	//whoever schedules the consumer next must see the new rear, pairs with the seq_cst
+	//store that ends a worker's turn on the category
+	atomic_thread_fence(memory_order_seq_cst);
+	return n;
 }
 
-sale_reportPtr createNewSale(int c_id, char * b_title, float b_price, float rembal){
-	sale_reportPtr report = (sale_reportPtr) malloc(sizeof(struct sale_struct));
+int tryPopOrder(orderBufferPtr ob, struct info_t *order){
+	return tryPopOrders(ob, order, 1);
+}
 
-	report->customer_id = c_id;
-	report->booktitle = b_title;
-	report->bookprice = b_price;
-	report->remaining_balance = rembal;
+int tryPopOrders(orderBufferPtr ob, struct info_t *orders, int max){
+	unsigned int front = atomic_load_explicit(&ob->front, memory_order_relaxed);
+	unsigned int available = ob->cachedRear - front;
+	int i, n;
 
-	return report;
+	if(available < max){
+		ob->cachedRear = atomic_load_explicit(&ob->rear, memory_order_acquire);
+		available = ob->cachedRear - front;
+		if(available == 0)
+			return 0;
+	}
+	n = (available < max) ? available : max;
+
+	for(i = 0; i < n; i++){
+		takeGrownBuffer(ob, front + i);
+		orders[i] = ob->consumerBuf[(front + i) & (ob->consumerSize - 1)];
+	}
+	//the orders are copied out, the producer may reuse their slots from here on
+	atomic_store_explicit(&ob->front, front + n, memory_order_release);
+
+	//pairs with the fence in waitForSpace
+	atomic_thread_fence(memory_order_seq_cst);
+	if(atomic_load_explicit(&ob->producerWaiting, memory_order_relaxed)){
+		atomic_fetch_add(&ob->spaceAvailable, 1);
+		futexWake(&ob->spaceAvailable);
+	}
+	return n;
+}
+
+void waitForSpace(orderBufferPtr ob, const struct wait_policy *policy){
+	int seen, step = 0;
+
+	//the consumer usually frees a slot within moments, look again a while before paying for a sleep
+	while(atomic_load(&ob->rear) - atomic_load(&ob->front) == ob->size){
+		if(!backoff(policy, &step))
+			break;
+	}
+	if(atomic_load(&ob->rear) - atomic_load(&ob->front) != ob->size)
+		return;
+
+	seen = atomic_load(&ob->spaceAvailable);
+	//announce the wait, then look again: a pop that missed the flag is seen here
+	atomic_store(&ob->producerWaiting, 1);
+	atomic_thread_fence(memory_order_seq_cst);
+	if(atomic_load(&ob->rear) - atomic_load(&ob->front) == ob->size)
+		futexWait(&ob->spaceAvailable, seen);
+	atomic_store(&ob->producerWaiting, 0);
+}
+
+void closeOrderBuffer(orderBufferPtr ob){
+	atomic_store(&ob->closed, 1);
+}
+
+int orderBufferDrained(orderBufferPtr ob){
+	//closed is read first, every order added before the close is then visible in rear
+	if(!atomic_load_explicit(&ob->closed, memory_order_acquire))
+		return 0;
+	return atomic_load_explicit(&ob->rear, memory_order_acquire) == atomic_load_explicit(&ob->front, memory_order_relaxed);
+}
+
+int formatCents(int64_t cents, char *out){
+	char digits[CENTS_STRLEN];
+	uint64_t amount = (cents < 0) ? -(uint64_t)cents : (uint64_t)cents;
+	int numDigits = 0, length = 0;
+
+	//digits come out least significant first, at least 3 so there is always a dollar digit
+	do{
+		digits[numDigits++] = '0' + amount % 10;
+		amount /= 10;
+	}while(amount > 0 || numDigits < 3);
+
+	if(cents < 0)
+		out[length++] = '-';
+	while(numDigits > 2)
+		out[length++] = digits[--numDigits];
+	out[length++] = '.';
+	out[length++] = digits[1];
+	out[length++] = digits[0];
+	out[length] = '\0';
+
+	return length;
 }
 
 int compareSales(void* r1, void* r2){
@@ -92,7 +238,11 @@ void destroySales(void* rep){
 	if(temprep == NULL)
 		return;
 	else{
-		//booktitles are freed by the cleanup function
+		//booktitles belong to the title pool which cleanup destroys
 		free(rep);
 	}
 }
+
+int orderBufferReady(orderBufferPtr ob){
+	return atomic_load(&ob->rear) != atomic_load(&ob->front) || atomic_load(&ob->closed);
+}
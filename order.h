@@ -6,30 +6,69 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <unistd.h>
+#include <stdatomic.h>
 #include "customer.h"
+#include "intern.h"
+#include "backoff.h"
 
 //an order object (created by producer and not yet processed)
+//the title is interned, every order for the same book shares one copy of it
 struct info_t{
      int customer_id; //for customer funds
-     char *book_name; //for price of book
-     float bookprice;
+     internedPtr title;
+     int64_t bookprice; //in cents
+     long position; //offset of the order in orders.txt, ties sales across a category's shards
 };
 typedef struct info_t *orderInfoPtr;
 
-//an orderbuffer struct, each consumer will have access to its own
-//each one keeps track of its count, and conditional variables, so 
-//each consumer "thinks" it has exclusive communication with the producer
-//prevents deadlocks by keeping sharing to a minimum and locking to a minimum
+#define CACHE_LINE 64
+
+//an orderbuffer struct, one per category
+//a single producer single consumer ring: only the producer moves rear and only the
+//consumer moves front, so adding and taking orders needs no lock. Several producers
+//may feed one buffer as long as they take turns, publishing is handed over under a mutex,
+//and several pool workers may drain it as long as only one of them runs the category at once
+//
+//front and rear count every order ever taken and added and are never wrapped, the slot is
+//the count masked by size-1. Each side keeps its own cache line so the two threads do not
+//bounce one line back and forth on every order
+//
+//the producer only waits when the ring is full, it spins and yields as its wait_policy allows
+//and then parks on a futex word that the consumer bumps when it sees the waiting flag set.
+//Consumers never wait on the ring,
+//the producer schedules the category with the worker pool after adding orders
+//
+//orders are copied into the ring's slots by value and copied out again when taken, a slot
+//is reused as soon as the consumer moves front past it, so adding and taking orders allocates nothing
+//
+//the producer can grow the ring while the consumer keeps going: it hands over a bigger
+//array through nextBuf and writes every order from switchAt on into it, the consumer
+//moves to the new array when it reaches switchAt and frees the old one
 struct orders_struct{
-	pthread_t tid; //contains the thread id of the consumer that owns this buffer
-	orderInfoPtr *buf;
-	int size; //should equal MAXBUFSIZE
-	int count; //shound not exceed MAXBUFSIZE
-	int front;
-	int rear;
-	pthread_mutex_t mutex;
-    pthread_cond_t dataAvailable;
-    pthread_cond_t spaceAvailable; 
+	//written by the producer
+	_Alignas(CACHE_LINE) atomic_uint rear;
+	unsigned int cachedFront; //front as last read by the producer, reread only when the ring looks full
+	struct info_t *buf; //the slots the producer writes to
+	unsigned int size; //a power of 2, at least the size asked for
+	int stalls; //times the producer found the ring full since it last grew
+
+	//written by the consumer
+	_Alignas(CACHE_LINE) atomic_uint front;
+	unsigned int cachedRear; //rear as last read by the consumer, reread only when the ring looks empty
+	struct info_t *consumerBuf; //the slots the consumer reads from, buf until a grow is picked up
+	unsigned int consumerSize;
+
+	//a grown array waiting for the consumer, NULL when there is none
+	_Atomic(struct info_t *) nextBuf;
+	unsigned int nextSize;
+	unsigned int switchAt; //first order written to nextBuf
+
+	//set once no more orders will be added
+	_Alignas(CACHE_LINE) atomic_int closed;
+
+	//futex word and waiting flag used only when the producer has to sleep
+	atomic_int spaceAvailable;
+	atomic_int producerWaiting;
 };
 typedef struct orders_struct *orderBufferPtr;
 
@@ -37,20 +76,23 @@ typedef struct orders_struct *orderBufferPtr;
 //can be added to acceptedSales or rejectedSales sorted lists depending on customer funds
 struct sale_struct{
 	int customer_id;
-	char *booktitle;
-	float bookprice;
-	float remaining_balance;
+	internedPtr title; //shared with the order, owned by the title pool
+	int64_t bookprice; //in cents
+	int64_t remaining_balance; //in cents
+	long position; //of the order in orders.txt
+	int seq; //position it was recorded at in its run
+	int afterHead; //recorded while an equal sale was the smallest in its run, see sales.h
 };
 typedef struct sale_struct * sale_reportPtr;
 
-//allocates a customer pointer (located in customer.h)
-customerPtr createCustomer(char *name, char *add, char *zip, char *state, float bal);
-
-//free memory when done
-void killCustomer(customerPtr tempcust);
+//takes amount off the customer's balance if the balance covers it
+//remaining gets the balance after the debit, or the untouched balance when it is refused
+//returns 1 if the balance was debited, 0 if it was refused
+//lock free with ATOMIC_BALANCES, otherwise the caller must hold the customer's lock
+int debitBalance(customerPtr customer, int64_t amount, int64_t *remaining);
 
-//producer creates orders with this function
-orderInfoPtr init_newOrder(int, char*, float);
+//producer fills in orders with this function, orders are kept by value until they are copied into a ring slot
+void init_newOrder(orderInfoPtr, int, internedPtr, int64_t, long);
 
 //hashmap links categories to buffers initialized by this function
 void init_order_buf(orderBufferPtr ob, int buf_size);
@@ -58,11 +100,46 @@ void init_order_buf(orderBufferPtr ob, int buf_size);
 //clean memory when done with buffer
 void kill_order_buf(orderBufferPtr ob);
 
-//cleans individual orders when we are done with it
-void free_order(orderInfoPtr order);
+//producer side: gives the buffer room for at least new_size orders without stopping the consumer
+//returns the new size, or 0 if the buffer is already that big or an earlier grow has not been
+//picked up by the consumer yet
+unsigned int growOrderBuffer(orderBufferPtr ob, int new_size);
+
+//producer side: copies an order into the buffer
+//returns 1 on success, 0 if the buffer is full
+int tryPushOrder(orderBufferPtr ob, const struct info_t *order);
+
+//producer side: copies as many of the n orders as there is room for into the buffer, in order,
+//with a single update of rear
+//returns how many were added, 0 if the buffer is full
+int tryPushOrders(orderBufferPtr ob, const struct info_t *orders, int n);
+
+//consumer side: copies the oldest order out of the buffer into order
+//returns 1 on success, 0 if the buffer is empty
+int tryPopOrder(orderBufferPtr ob, struct info_t *order);
+
+//consumer side: copies up to max of the oldest orders out of the buffer at once
+//returns how many were taken, 0 if the buffer is empty
+int tryPopOrders(orderBufferPtr ob, struct info_t *orders, int max);
+
+//producer side: waits until the buffer has room, spinning, yielding and then sleeping as the policy says
+void waitForSpace(orderBufferPtr ob, const struct wait_policy *policy);
+
+//no more orders will be added, called once nothing can push to the buffer anymore
+//the consumer drains what is left and stops
+void closeOrderBuffer(orderBufferPtr ob);
+
+//consumer side: returns 1 once the buffer is closed and every order in it has been taken
+int orderBufferDrained(orderBufferPtr ob);
+
+//returns 1 if the buffer has orders to take or has been closed, so its consumer has something to do
+int orderBufferReady(orderBufferPtr ob);
 
-//created by the consumer, added to the sortedlist after order has been processed
-sale_reportPtr createNewSale(int c_id, char * b_title, float b_price, float rembal);
+//writes an amount of cents as dollars with two decimals, the same text printf("%.2f") gives
+//without going through floating point, out needs CENTS_STRLEN characters
+//returns the length of the string written
+#define CENTS_STRLEN 24
+int formatCents(int64_t cents, char *out);
 
 //comparator function used for sorted list
 int compareSales(void* rep1, void* rep2);
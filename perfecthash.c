@@ -0,0 +1,143 @@
+#include "perfecthash.h"
+
+//spreads every bit of x over the whole word, FNV alone leaves similar strings close together
+uint64_t mixBits(uint64_t x){
+	x ^= x >> 33;
+	x *= 0xff51afd7ed558ccdULL;
+	x ^= x >> 33;
+	x *= 0xc4ceb9fe1a85ec53ULL;
+	x ^= x >> 33;
+	return x;
+}
+
+//the bucket a string hash falls in
+uint32_t bucketOf(uint64_t hash, int numBuckets){
+	return (uint32_t)(((mixBits(hash) >> 32) * (uint64_t) numBuckets) >> 32);
+}
+
+//the slot a string hash lands in with its bucket's seed, every seed gives a new spread
+uint32_t slotOf(uint64_t hash, uint32_t seed, int numKeys){
+	return (uint32_t)(((mixBits(hash ^ ((uint64_t) seed * 0x9E3779B97F4A7C15ULL)) >> 32) * (uint64_t) numKeys) >> 32);
+}
+
+//looks for a seed for every bucket, fullest bucket first while free slots are easy to find
+//returns 0 on success, -1 if some bucket had no seed that fit
+int placeBuckets(perfectHashPtr ph, internedPtr *keys, int *bucketStart, int *bucketKeys, int *order){
+	uint32_t slots[ph->numKeys];
+	char *taken = (char *) calloc(ph->numKeys, 1);
+	uint32_t seed;
+	int b, bucket, i, j, size, fits;
+
+	for(b = 0; b < ph->numBuckets; b++){
+		bucket = order[b];
+		size = bucketStart[bucket + 1] - bucketStart[bucket];
+		if(size == 0)
+			break;
+
+		for(seed = 0; seed < PERFECT_MAX_SEED; seed++){
+			fits = 1;
+			for(i = 0; i < size && fits; i++){
+				slots[i] = slotOf(keys[bucketKeys[bucketStart[bucket] + i]]->hash, seed, ph->numKeys);
+				fits = !taken[slots[i]];
+				for(j = 0; j < i && fits; j++)
+					fits = slots[j] != slots[i];
+			}
+			if(fits)
+				break;
+		}
+		if(seed == PERFECT_MAX_SEED){
+			free(taken);
+			return -1;
+		}
+
+		ph->seeds[bucket] = seed;
+		for(i = 0; i < size; i++){
+			taken[slots[i]] = 1;
+			ph->keys[slots[i]] = keys[bucketKeys[bucketStart[bucket] + i]];
+		}
+	}
+	free(taken);
+	return 0;
+}
+
+//the bucket sizes placeBuckets sorts by, qsort gives no way to pass them along
+_Thread_local int *sortingStarts;
+
+int compareBucketSizes(const void *a, const void *b){
+	int sizeA = sortingStarts[*(const int *) a + 1] - sortingStarts[*(const int *) a];
+	int sizeB = sortingStarts[*(const int *) b + 1] - sortingStarts[*(const int *) b];
+
+	return sizeB - sizeA;
+}
+
+int buildPerfectHash(perfectHashPtr ph, internedPtr *keys, int numKeys){
+	int *bucketStart, *bucketKeys, *order, *filled;
+	int i, bucket, built = -1;
+
+	ph->numKeys = numKeys;
+	ph->keys = (internedPtr *) calloc(numKeys ? numKeys : 1, sizeof(internedPtr));
+	ph->seeds = NULL;
+	ph->numBuckets = 0;
+	if(numKeys == 0)
+		return 0;
+
+	//about two keys a bucket, a set that will not fit gets more and smaller buckets
+	for(ph->numBuckets = numKeys/2 + 1; built < 0 && ph->numBuckets <= 2*numKeys + 2; ph->numBuckets *= 2){
+		ph->seeds = (uint32_t *) realloc(ph->seeds, ph->numBuckets * sizeof(uint32_t));
+		memset(ph->seeds, 0, ph->numBuckets * sizeof(uint32_t));
+		memset(ph->keys, 0, numKeys * sizeof(internedPtr));
+
+		//group the keys by bucket
+		bucketStart = (int *) calloc(ph->numBuckets + 1, sizeof(int));
+		filled = (int *) calloc(ph->numBuckets, sizeof(int));
+		bucketKeys = (int *) malloc(numKeys * sizeof(int));
+		order = (int *) malloc(ph->numBuckets * sizeof(int));
+		for(i = 0; i < numKeys; i++)
+			bucketStart[bucketOf(keys[i]->hash, ph->numBuckets) + 1]++;
+		for(i = 0; i < ph->numBuckets; i++){
+			bucketStart[i + 1] += bucketStart[i];
+			order[i] = i;
+		}
+		for(i = 0; i < numKeys; i++){
+			bucket = bucketOf(keys[i]->hash, ph->numBuckets);
+			bucketKeys[bucketStart[bucket] + filled[bucket]++] = i;
+		}
+
+		sortingStarts = bucketStart;
+		qsort(order, ph->numBuckets, sizeof(int), compareBucketSizes);
+		sortingStarts = NULL;
+		built = placeBuckets(ph, keys, bucketStart, bucketKeys, order);
+
+		free(bucketStart);
+		free(filled);
+		free(bucketKeys);
+		free(order);
+		if(built == 0)
+			return 0;
+	}
+	return -1;
+}
+
+void freePerfectHash(perfectHashPtr ph){
+	free(ph->keys);
+	free(ph->seeds);
+	ph->keys = NULL;
+	ph->seeds = NULL;
+	ph->numKeys = ph->numBuckets = 0;
+}
+
+internedPtr perfectLookup(perfectHashPtr ph, const char *text, int length){
+	uint64_t hash;
+	internedPtr key;
+
+	if(ph->numKeys == 0)
+		return NULL;
+
+	hash = hashString(text, length);
+	key = ph->keys[slotOf(hash, ph->seeds[bucketOf(hash, ph->numBuckets)], ph->numKeys)];
+
+	//a string outside the set still lands in some key's slot, the compare turns it away
+	if(key->hash != hash || key->length != length || memcmp(key->text, text, length) != 0)
+		return NULL;
+	return key;
+}
@@ -0,0 +1,42 @@
+#ifndef PERFECTHASH_H
+#define PERFECTHASH_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "intern.h"
+
+/*
+ * Minimal perfect hash over a fixed set of interned strings
+ *
+ * Built once the set is known, hash and displace: every key falls in a bucket
+ * by its string hash, and each bucket gets a seed chosen so that its keys land
+ * in slots no other key took. With one slot per key a lookup is one string
+ * hash, two table reads and one compare against the key in its slot, a string
+ * outside the set fails that compare. The table is only read after it is built,
+ * lookups take no lock.
+ */
+
+#define PERFECT_MAX_SEED (1 << 16) //seeds tried for a bucket before the table is rebuilt with more buckets
+
+struct perfect_hash{
+	internedPtr *keys; //the key in each slot
+	uint32_t *seeds; //seed of each bucket
+	int numKeys;
+	int numBuckets;
+};
+typedef struct perfect_hash * perfectHashPtr;
+
+// Builds a table over numKeys distinct interned strings, the strings must outlive it
+// returns 0 on success, -1 if no seeds were found
+int buildPerfectHash(perfectHashPtr ph, internedPtr *keys, int numKeys);
+
+// Frees the table, not the keys
+void freePerfectHash(perfectHashPtr ph);
+
+// Returns the key equal to text, or NULL if text is not in the set
+// text does not need to be null terminated
+internedPtr perfectLookup(perfectHashPtr ph, const char *text, int length);
+
+#endif
@@ -0,0 +1,198 @@
+#include "sales.h"
+
+void initSaleRun(saleRunPtr run){
+	run->sales = NULL;
+	run->count = run->capacity = 0;
+	run->sorted = 1;
+}
+
+void freeSaleRun(saleRunPtr run){
+	free(run->sales);
+	initSaleRun(run);
+}
+
+void appendSale(saleRunPtr run, int customer_id, internedPtr title, int64_t bookprice, int64_t remaining_balance, long position){
+	struct sale_struct *sale;
+
+	if(run->count == run->capacity){
+		run->capacity = run->capacity ? run->capacity*2 : 256;
+		run->sales = (struct sale_struct *) realloc(run->sales, run->capacity * sizeof(struct sale_struct));
+	}
+	sale = &run->sales[run->count];
+	sale->customer_id = customer_id;
+	sale->title = title;
+	sale->bookprice = bookprice;
+	sale->remaining_balance = remaining_balance;
+	sale->position = position;
+	sale->seq = run->count;
+
+	//in a sorted list this sale would meet an equal head and go in behind it
+	sale->afterHead = run->count >= 2 && compareSales(&run->smallest, sale) == 0;
+	if(run->count == 0 || compareSales(sale, &run->smallest) < 0)
+		run->smallest = *sale;
+
+	run->count++;
+	run->sorted = 0;
+}
+
+//orders by compareSales, equal sales in the order they were recorded
+int compareRecorded(const void *s1, const void *s2){
+	const struct sale_struct *sale1 = (const struct sale_struct *) s1;
+	const struct sale_struct *sale2 = (const struct sale_struct *) s2;
+	int order = compareSales((void *) sale1, (void *) sale2);
+
+	if(order != 0)
+		return order;
+	return (sale1->seq > sale2->seq) - (sale1->seq < sale2->seq);
+}
+
+//rearranges a group of equal sales, given in recorded order, the way SLInsert would have left them
+//each insert either becomes the new head of the group or goes right behind it, and in both
+//cases the sale it displaces lands right behind the head, so the group ends up as its last
+//head followed by the displaced sales newest first
+void placeEqualSales(struct sale_struct *group, int count, struct sale_struct *scratch){
+	struct sale_struct head = group[0];
+	int displaced = 0, i;
+
+	for(i = 1; i < count; i++){
+		if(group[i].afterHead){
+			scratch[displaced++] = group[i];
+		}
+		else{
+			scratch[displaced++] = head;
+			head = group[i];
+		}
+	}
+
+	group[0] = head;
+	for(i = 0; i < displaced; i++)
+		group[i+1] = scratch[displaced-1-i];
+}
+
+void sortSaleRun(saleRunPtr run){
+	struct sale_struct *scratch;
+	int start, end;
+
+	if(run->sorted)
+		return;
+
+	qsort(run->sales, run->count, sizeof(struct sale_struct), compareRecorded);
+
+	scratch = (struct sale_struct *) malloc(run->count * sizeof(struct sale_struct));
+	for(start = 0; start < run->count; start = end){
+		for(end = start+1; end < run->count && compareSales(&run->sales[start], &run->sales[end]) == 0; end++);
+		if(end - start > 1)
+			placeEqualSales(&run->sales[start], end - start, scratch);
+	}
+	free(scratch);
+
+	run->sorted = 1;
+}
+
+//orders pointers to sales by the position of their orders
+int comparePositions(const void *s1, const void *s2){
+	const struct sale_struct *sale1 = *(sale_reportPtr const *) s1;
+	const struct sale_struct *sale2 = *(sale_reportPtr const *) s2;
+
+	return (sale1->position > sale2->position) - (sale1->position < sale2->position);
+}
+
+void placeTiesAcrossRuns(saleRunPtr *runs, int numRuns){
+	sale_reportPtr *sales, smallest = NULL;
+	int total = 0, i, j;
+
+	for(i = 0; i < numRuns; i++)
+		total += runs[i]->count;
+	sales = (sale_reportPtr *) malloc((total ? total : 1) * sizeof(sale_reportPtr));
+	for(i = 0, total = 0; i < numRuns; i++){
+		for(j = 0; j < runs[i]->count; j++)
+			sales[total++] = &runs[i]->sales[j];
+	}
+	qsort(sales, total, sizeof(sale_reportPtr), comparePositions);
+
+	//the same test appendSale makes, against every sale recorded before in any of the runs
+	//equal sales share a customer and so a run, its own order stays the recorded one
+	for(i = 0; i < total; i++){
+		sales[i]->afterHead = i >= 2 && compareSales(smallest, sales[i]) == 0;
+		if(i == 0 || compareSales(sales[i], smallest) < 0)
+			smallest = sales[i];
+	}
+	free(sales);
+
+	for(i = 0; i < numRuns; i++){
+		runs[i]->sorted = 0;
+		sortSaleRun(runs[i]);
+	}
+}
+
+//returns 1 if run1's next sale comes before run2's
+int mergeBefore(saleMergePtr merge, int run1, int run2){
+	int order = compareSales(&merge->runs[run1]->sales[merge->next[run1]], &merge->runs[run2]->sales[merge->next[run2]]);
+
+	return order < 0 || (order == 0 && run1 < run2);
+}
+
+//moves the run at position i of the heap down until both children come after it
+void siftDown(saleMergePtr merge, int i){
+	int smallest, child, temp;
+
+	while(1){
+		smallest = i;
+		for(child = 2*i + 1; child <= 2*i + 2; child++){
+			if(child < merge->heapSize && mergeBefore(merge, merge->heap[child], merge->heap[smallest]))
+				smallest = child;
+		}
+		if(smallest == i)
+			return;
+		temp = merge->heap[i];
+		merge->heap[i] = merge->heap[smallest];
+		merge->heap[smallest] = temp;
+		i = smallest;
+	}
+}
+
+void initSaleMerge(saleMergePtr merge, saleRunPtr *runs, int numRuns){
+	int i;
+
+	merge->runs = runs;
+	merge->next = (int *) calloc(numRuns, sizeof(int));
+	merge->heap = (int *) malloc(numRuns * sizeof(int));
+	merge->heapSize = 0;
+	for(i = 0; i < numRuns; i++){
+		if(runs[i]->count > 0)
+			merge->heap[merge->heapSize++] = i;
+	}
+	for(i = merge->heapSize/2 - 1; i >= 0; i--)
+		siftDown(merge, i);
+}
+
+void freeSaleMerge(saleMergePtr merge){
+	free(merge->next);
+	free(merge->heap);
+	merge->next = merge->heap = NULL;
+	merge->heapSize = 0;
+}
+
+sale_reportPtr peekMergedSale(saleMergePtr merge){
+	int run;
+
+	if(merge->heapSize == 0)
+		return NULL;
+	run = merge->heap[0];
+	return &merge->runs[run]->sales[merge->next[run]];
+}
+
+sale_reportPtr nextMergedSale(saleMergePtr merge){
+	sale_reportPtr sale = peekMergedSale(merge);
+	int run;
+
+	if(sale == NULL)
+		return NULL;
+
+	//a run that is used up leaves the heap, its place taken by the last one
+	run = merge->heap[0];
+	if(++merge->next[run] == merge->runs[run]->count)
+		merge->heap[0] = merge->heap[--merge->heapSize];
+	siftDown(merge, 0);
+	return sale;
+}
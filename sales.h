@@ -0,0 +1,74 @@
+#ifndef SALES_H
+#define SALES_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "order.h"
+
+/*
+ * Runs of sales
+ *
+ * A consumer appends its sales to its own run without any lock, the run is sorted
+ * once when the consumer is done and the report merges every consumer's runs.
+ *
+ * Runs are ordered by compareSales. Sales that compare equal come out in the order
+ * SLInsert leaves them in when the same sales are inserted into a sorted list one
+ * after another: the newest first, except that a sale equal to the smallest sale
+ * of a list holding two or more goes right after the list's head. Every sale
+ * remembers whether that was the case when it was recorded so sorting the run
+ * later can put it in the same place.
+ *
+ * A category split into shards keeps a run per shard, and the smallest sale a shard
+ * has seen is not the smallest its category has seen. Each sale keeps its order's
+ * position in orders.txt, placeTiesAcrossRuns replays the category's sales in that
+ * order, so equal sales come out the same for any shard count.
+ */
+
+struct sale_run{
+	struct sale_struct *sales;
+	int count;
+	int capacity;
+	int sorted; //no sale was added since the run was last sorted
+	struct sale_struct smallest; //smallest sale recorded so far, by compareSales
+};
+typedef struct sale_run * saleRunPtr;
+
+//merges sorted runs, the next sale is always the smallest left in any run
+struct sale_merge{
+	saleRunPtr *runs;
+	int *next; //next position in each run
+	int *heap; //runs that still have sales, smallest next sale first
+	int heapSize;
+};
+typedef struct sale_merge * saleMergePtr;
+
+// Sets up an empty run
+void initSaleRun(saleRunPtr run);
+
+// Frees the run's sales
+void freeSaleRun(saleRunPtr run);
+
+// Records a sale at the end of the run
+void appendSale(saleRunPtr run, int customer_id, internedPtr title, int64_t bookprice, int64_t remaining_balance, long position);
+
+// Sorts the run if sales were added since it was last sorted
+void sortSaleRun(saleRunPtr run);
+
+// Places equal sales as if the sales of all numRuns runs had been recorded in one run
+// in order of position, then sorts every run again
+void placeTiesAcrossRuns(saleRunPtr *runs, int numRuns);
+
+// Starts merging numRuns sorted runs, ties between runs go to the lower run index
+void initSaleMerge(saleMergePtr merge, saleRunPtr *runs, int numRuns);
+
+// Frees the merge's bookkeeping, not the runs
+void freeSaleMerge(saleMergePtr merge);
+
+// Returns the smallest sale left without taking it, NULL when every run is used up
+sale_reportPtr peekMergedSale(saleMergePtr merge);
+
+// Takes the smallest sale left, NULL when every run is used up
+sale_reportPtr nextMergedSale(saleMergePtr merge);
+
+#endif
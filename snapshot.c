@@ -0,0 +1,168 @@
+#include "snapshot.h"
+#include <errno.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+//returns the snapshot file name for dbFile, caller frees it
+char *snapshotPath(const char *dbFile, const char *suffix){
+	char *path = (char *) malloc(strlen(dbFile) + strlen(suffix) + 1);
+
+	strcpy(path, dbFile);
+	strcat(path, suffix);
+	return path;
+}
+
+//turns a blob offset stored in a string field into a pointer
+//returns -1 if the offset does not point inside the blob
+int fixupString(char **field, char *blob, uint64_t blob_size){
+	uint64_t offset = (uint64_t)(uintptr_t) *field;
+
+	if(offset >= blob_size)
+		return -1;
+	*field = blob + offset;
+	return 0;
+}
+
+//checks the header against the text database and the size of the mapping
+int snapshotMatches(mappedFilePtr mf, struct stat *db_st){
+	struct snapshot_header *header = (struct snapshot_header *) mf->data;
+
+	if(mf->size < sizeof(struct snapshot_header))
+		return 0;
+	if(memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(header->magic)) != 0 || header->record_size != sizeof(struct snapshot_record))
+		return 0;
+	if(header->count == 0 || header->blob_size == 0)
+		return 0;
+	//stale if the text database changed since the snapshot was written
+	if(header->db_size != db_st->st_size || header->db_mtime_sec != db_st->st_mtim.tv_sec || header->db_mtime_nsec != db_st->st_mtim.tv_nsec)
+		return 0;
+	if(mf->size != sizeof(struct snapshot_header) + (uint64_t) header->count * sizeof(struct snapshot_record) + header->blob_size)
+		return 0;
+	return mf->data[mf->size - 1] == '\0';
+}
+
+int loadSnapshot(const char *dbFile, mappedFilePtr mf, customerTablePtr table){
+	struct stat db_st;
+	struct snapshot_header *header;
+	struct snapshot_record *records;
+	char *path, *blob;
+	uint32_t i;
+	int mapped;
+
+	if(stat(dbFile, &db_st) < 0)
+		return -1;
+
+	path = snapshotPath(dbFile, SNAPSHOT_SUFFIX);
+	mapped = mapFile(path, mf, 1);
+	free(path);
+	if(mapped < 0)
+		return -1;
+
+	if(!snapshotMatches(mf, &db_st)){
+		unmapFile(mf);
+		return -1;
+	}
+
+	header = (struct snapshot_header *) mf->data;
+	records = (struct snapshot_record *) (mf->data + sizeof(struct snapshot_header));
+	blob = (char *) (records + header->count);
+
+	//every offset is checked before any customer is added, a bad snapshot leaves the table untouched
+	for(i = 0; i < header->count; i++){
+		if(fixupString(&records[i].customer.name, blob, header->blob_size) < 0
+			|| fixupString(&records[i].customer.address, blob, header->blob_size) < 0
+			|| fixupString(&records[i].customer.state, blob, header->blob_size) < 0
+			|| fixupString(&records[i].customer.zip, blob, header->blob_size) < 0){
+			unmapFile(mf);
+			return -1;
+		}
+	}
+
+	initCustomerTable(table, header->count);
+	for(i = 0; i < header->count; i++){
+		addCustomer(table, records[i].customer_id, &records[i].customer);
+	}
+	finishCustomerTable(table);
+
+	return 0;
+}
+
+//appends a string to the blob and returns its offset disguised as a pointer
+char *blobString(const char *text, uint64_t *blob_size){
+	uint64_t offset = *blob_size;
+
+	*blob_size += strlen(text) + 1;
+	return (char *)(uintptr_t) offset;
+}
+
+int writeSnapshot(const char *dbFile, customerTablePtr table){
+	struct stat db_st;
+	struct snapshot_header header;
+	struct snapshot_record record;
+	customerSlotPtr entry;
+	unsigned int i;
+	char *path, *tempPath;
+	FILE *fp;
+	int failed = 0;
+
+	if(stat(dbFile, &db_st) < 0)
+		return -1;
+
+	memset(&header, 0, sizeof(header));
+	memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(header.magic));
+	header.record_size = sizeof(struct snapshot_record);
+	header.count = table->count;
+	header.db_size = db_st.st_size;
+	header.db_mtime_sec = db_st.st_mtim.tv_sec;
+	header.db_mtime_nsec = db_st.st_mtim.tv_nsec;
+	for(i = 0; i < table->count; i++){
+		entry = customerByRank(table, i);
+		header.blob_size += strlen(entry->customer.name) + strlen(entry->customer.address)
+			+ strlen(entry->customer.state) + strlen(entry->customer.zip) + 4;
+	}
+
+	//write to a temporary file and rename it so a reader never sees half a snapshot
+	path = snapshotPath(dbFile, SNAPSHOT_SUFFIX);
+	tempPath = snapshotPath(path, ".tmp");
+	if((fp = fopen(tempPath, "wb")) == NULL){
+		free(path);
+		free(tempPath);
+		return -1;
+	}
+
+	failed |= fwrite(&header, sizeof(header), 1, fp) != 1;
+
+	//records in order of id, so the strings of neighbouring customers sit together in the blob
+	header.blob_size = 0;
+	for(i = 0; i < table->count && !failed; i++){
+		entry = customerByRank(table, i);
+		memset(&record, 0, sizeof(record));
+		record.customer = entry->customer;
+		record.customer.name = blobString(entry->customer.name, &header.blob_size);
+		record.customer.address = blobString(entry->customer.address, &header.blob_size);
+		record.customer.state = blobString(entry->customer.state, &header.blob_size);
+		record.customer.zip = blobString(entry->customer.zip, &header.blob_size);
+		record.customer_id = entry->customer_id;
+		failed |= fwrite(&record, sizeof(record), 1, fp) != 1;
+	}
+
+	for(i = 0; i < table->count && !failed; i++){
+		entry = customerByRank(table, i);
+		failed |= fwrite(entry->customer.name, strlen(entry->customer.name) + 1, 1, fp) != 1;
+		failed |= fwrite(entry->customer.address, strlen(entry->customer.address) + 1, 1, fp) != 1;
+		failed |= fwrite(entry->customer.state, strlen(entry->customer.state) + 1, 1, fp) != 1;
+		failed |= fwrite(entry->customer.zip, strlen(entry->customer.zip) + 1, 1, fp) != 1;
+	}
+
+	failed |= fclose(fp) != 0;
+	if(failed || rename(tempPath, path) < 0){
+		int saved = errno;
+		unlink(tempPath);
+		errno = saved;
+		failed = 1;
+	}
+
+	free(path);
+	free(tempPath);
+	return failed ? -1 : 0;
+}
@@ -0,0 +1,47 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+/*
+ * Binary snapshot of the customer database
+ *
+ * Layout: a header, count fixed width records, then a blob of null terminated
+ * strings. A record holds a CustomerStruct whose string fields are offsets into
+ * the blob while on disk; loading maps the file copy-on-write and turns the
+ * offsets into pointers in place, so the customers' strings live inside the mapping.
+ *
+ * The snapshot remembers the size and modification time of the text database
+ * it was made from and is only used while those still match.
+ */
+
+#include <stdint.h>
+#include "custtable.h"
+#include "mapfile.h"
+
+#define SNAPSHOT_SUFFIX ".snap"
+#define SNAPSHOT_MAGIC "BOOKSNP3" //bumped whenever struct CustomerStruct changes
+
+struct snapshot_header{
+	char magic[8];
+	uint32_t record_size; //sizeof(struct snapshot_record), rejects snapshots from other builds
+	uint32_t count;
+	uint64_t blob_size;
+	int64_t db_size;
+	int64_t db_mtime_sec;
+	int64_t db_mtime_nsec;
+};
+
+struct snapshot_record{
+	struct CustomerStruct customer;
+	int customer_id;
+};
+
+// Loads the snapshot next to dbFile into an empty customer table if it is fresh
+// the customers' strings point into mf, which must stay mapped until the table is cleared
+// returns 0 on success, -1 if there is no usable snapshot
+int loadSnapshot(const char *dbFile, mappedFilePtr mf, customerTablePtr table);
+
+// Writes a snapshot of the customer table next to dbFile, the table must be finished
+// returns 0 on success, -1 on failure with errno set
+int writeSnapshot(const char *dbFile, customerTablePtr table);
+
+#endif
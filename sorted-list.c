@@ -3,11 +3,11 @@
 *
 *Big-O analysis:
 *
-*Insert: O(n)
-*Remove: O(n)
+*Insert: O(log n) expected
+*Remove: O(log n) expected, plus the equal objects it has to walk past
 *Destroy List: O(n)
 *All others: O(1)
-*Generating a sorted list from a list of data: O(n^2)
+*Generating a sorted list from a list of data: O(n log n) expected
 */
 
 /**
@@ -15,6 +15,43 @@
  */
 
 #include "sorted-list.h"
+#include <string.h>
+
+//the link that follows prev on a level, a NULL prev is the start of the list
+NodePtr *linkAfter(SortedListPtr list, NodePtr prev, int level){
+	return (prev == NULL) ? &list->head[level] : &prev->next[level];
+}
+
+//picks how many levels a new node is on, each level above the first with probability 1/4
+int randomHeight(SortedListPtr list){
+	unsigned int bits;
+	int height = 1;
+
+	//xorshift, the heights only need to be spread out, not unpredictable
+	list->seed ^= list->seed << 13;
+	list->seed ^= list->seed >> 17;
+	list->seed ^= list->seed << 5;
+	bits = list->seed;
+
+	while(height < SL_MAX_LEVEL && (bits & 3) == 0){
+		height++;
+		bits >>= 2;
+	}
+	return height;
+}
+
+//takes node out of every level it is on and frees it, update holds the node before it on each level
+void unlinkNode(SortedListPtr list, NodePtr *update, NodePtr node){
+	int i;
+
+	for(i = 0; i < node->height; i++)
+		*linkAfter(list, update[i], i) = node->next[i];
+	while(list->level > 1 && list->head[list->level - 1] == NULL)
+		list->level--;
+
+	list->destroyer(node->data);
+	free(node);
+}
 
 SortedListPtr SLCreate(CompareFuncT cf, DestructFuncT df){
 	if(cf == NULL || df == NULL){
@@ -22,7 +59,9 @@ SortedListPtr SLCreate(CompareFuncT cf, DestructFuncT df){
 		return NULL;
 	}
 	SortedListPtr sl = (SortedListPtr) malloc(sizeof(struct SortedList));
-	sl->head = NULL;
+	memset(sl->head, 0, sizeof(sl->head));
+	sl->level = 1;
+	sl->seed = 2463534242u; //any nonzero start works for xorshift
 	sl->comparator = cf;
 	sl->destroyer = df;
 
@@ -35,9 +74,9 @@ void SLDestroy(SortedListPtr list){
 	else{
 		NodePtr deleter;
 
-		while(list->head != NULL){ //delete all dynamically allocated nodes
-			deleter = list->head;
-			list->head = list->head->next;
+		while(list->head[0] != NULL){ //delete all dynamically allocated nodes, every one of them is on level 0
+			deleter = list->head[0];
+			list->head[0] = deleter->next[0];
 			list->destroyer(deleter->data);
 			free(deleter);
 		}
@@ -48,139 +87,99 @@ void SLDestroy(SortedListPtr list){
 }
 
 //insert does not avoid duplicates, altered for threaded program
+//a new object goes before the objects equal to it, unless the head is equal to it and
+//the list holds two or more objects, then it goes right after the head
 int SLInsert(SortedListPtr list, void *newObj){
+	NodePtr update[SL_MAX_LEVEL]; //the last node before newObj on each level
+	NodePtr prev = NULL;
+	NodePtr head, tempNode;
+	int i, height;
+
 	if(list == NULL){
 		printf("List was not allocated properly\n");
 		return 0;
 	}
-	else{
-		//allocate a temporary node, which will be inserted into the list if its valid, free'd if its a duplicate
-		//each parameter is explained in the header file
-		NodePtr tempNode = (NodePtr) malloc(sizeof(struct Node));
-		tempNode->data = newObj;
-		tempNode->next = NULL;
-		tempNode->numPointers = 0;
-		tempNode->isValid = true;
-
-		if(list->head == NULL){ //if this is the first item to be added to the list
-			list->head = tempNode; //simply make it the head of the list
-		}
-		else if(list->head->next == NULL){ //there is only 1 item in the list
-			if(list->comparator(list->head->data, newObj) < 0){ //new object is smaller (it becomes second on list)
-				list->head->next = tempNode;
-				return 1;
-			}
-			else{ //new object is larger, it becomes the head
-				tempNode->next = list->head;
-				list->head = tempNode;
-				return 1;
-			}
-		}
-		else{ //there are at least 2 items in the list
-			if(list->comparator(list->head->data, newObj) > 0){ //if object is larger than head it becomes head
-				tempNode->next = list->head;
-				list->head = tempNode;
-				return 1;
-			}
-
-			NodePtr traverse = list->head->next;
-			NodePtr lagging = list->head;
-			while(traverse != NULL){
-				if(list->comparator(traverse->data, newObj) < 0){ //new object is smaller (it goes towards end of list)
-					lagging = traverse;
-					traverse = traverse->next;
-				}
-				else{ //new object is larger (add it to this spot)
-					tempNode->next = traverse;
-					lagging->next = tempNode;
-					return 1;
-				}
-			}
-			if(list->comparator(lagging->data, newObj) < 0){ //tests one more time, if smaller than last item, adds to the end of the list
-				lagging->next = tempNode;
-				return 1;
-			}
-		}
+
+	//from the top level down, go right while the next object is smaller than the new one
+	for(i = list->level - 1; i >= 0; i--){
+		while(*linkAfter(list, prev, i) != NULL && list->comparator((*linkAfter(list, prev, i))->data, newObj) < 0)
+			prev = *linkAfter(list, prev, i);
+		update[i] = prev;
+	}
+
+	//nothing is smaller, so prev stayed at the start on every level: an equal head
+	//of a longer list keeps its place and the new object follows it
+	head = list->head[0];
+	if(prev == NULL && head != NULL && head->next[0] != NULL && list->comparator(head->data, newObj) == 0){
+		for(i = 0; i < head->height; i++)
+			update[i] = head;
 	}
-	return 1; //makes compiler happy
+
+	height = randomHeight(list);
+	for(i = list->level; i < height; i++)
+		update[i] = NULL; //levels not in use yet start at the head
+	if(height > list->level)
+		list->level = height;
+
+	//each parameter is explained in the header file
+	tempNode = (NodePtr) malloc(sizeof(struct Node) + height * sizeof(NodePtr));
+	tempNode->data = newObj;
+	tempNode->numPointers = 0;
+	tempNode->isValid = true;
+	tempNode->height = height;
+	for(i = 0; i < height; i++){
+		tempNode->next[i] = *linkAfter(list, update[i], i);
+		*linkAfter(list, update[i], i) = tempNode;
+	}
+
+	return 1;
 }
 
-//also acts as a sort of garbage collection, when looking for newObj, it looks for invalid objects with no pointers to free the node
+//also acts as a sort of garbage collection, removed objects with no pointers left that it walks past are freed
 int SLRemove(SortedListPtr list, void *newObj){
+	NodePtr update[SL_MAX_LEVEL]; //the last node before the one being looked at, on each level
+	NodePtr prev = NULL;
+	NodePtr traverse, nextNode;
+	int i;
+
 	//base cases, avoids segfault
 	if(list == NULL){
 		printf("List was not allocated properly\n");
 		return 0;
 	}
-	else if(list->head == NULL){
+	else if(list->head[0] == NULL){
 		printf("List is empty\n");
 		return 0;
 	}
-	
-	//checks against head
-	else if(list->comparator(list->head->data, newObj) == 0){
-		if(list->head->numPointers == 0){
-			NodePtr tempNode = list->head; //must save node to be freed
-			list->head = list->head->next; //update head
-			list->destroyer(tempNode->data);
-			free(tempNode);
-			return 1;
-		}
-		else{
-			if(!list->head->isValid){ //if item was already removed but still has a pointer
-				printf("Item was not found\n");
-				return 0;
-			}
 
-			list->head->isValid = false;
+	//from the top level down, stop before the first object equal to newObj
+	for(i = list->level - 1; i >= 0; i--){
+		while(*linkAfter(list, prev, i) != NULL && list->comparator((*linkAfter(list, prev, i))->data, newObj) < 0)
+			prev = *linkAfter(list, prev, i);
+		update[i] = prev;
+	}
+
+	//the equal objects sit next to each other on level 0, the first one not yet removed is the one taken out
+	traverse = *linkAfter(list, prev, 0);
+	while(traverse != NULL && list->comparator(traverse->data, newObj) == 0){
+		if(traverse->isValid){
+			if(traverse->numPointers == 0)
+				unlinkNode(list, update, traverse);
+			else
+				traverse->isValid = false; //an iterator still points to it, it is freed once it is walked past with no pointers
 			return 1;
 		}
-	}
-	else
-	{
-		NodePtr lagging = list->head;
-		NodePtr traverse = list->head->next;
-
-		while(traverse != NULL)
-		{	
-			//garbage collection !!TEST GARBAGE COLLECTION MAKE SURE IT WORKS PROPERLY
-			if(!(traverse->isValid) && (traverse->numPointers == 0)){
-				lagging->next = traverse->next;
-				list->destroyer(traverse->data);
-				free(traverse);
-				traverse = lagging->next;
-			}
-
-			if(list->comparator(traverse->data, newObj) == 0)
-			{
-				if(traverse->numPointers == 0){
-					lagging->next = traverse->next;
-					list->destroyer(traverse->data);
-					free(traverse);
-					return 1;
-				}
-				else{
-					if(!traverse->isValid){ //if item was already removed but still has a pointer
-						printf("Item was not found\n");
-						return 0;
-					}
-
-					traverse->isValid = false;
-					return 1;
-				}	
-			}
-
-			lagging = traverse;
-			traverse = traverse->next;
-			
+		else if(traverse->numPointers == 0){ //garbage collection
+			nextNode = traverse->next[0];
+			unlinkNode(list, update, traverse);
+			traverse = nextNode;
+			continue;
 		}
-	}
-	//garbage collection for first item, done last so parsing isn't affected !!TEST THIS CASE AS WELL
-	if(!(list->head->isValid) && (list->head->numPointers == 0)){
-		NodePtr oldHead = list->head; //keep track of the old head to be free'd
-		list->head = list->head->next;
-		list->destroyer(oldHead->data);
-		free(oldHead);
+
+		//stepping past a node makes it the one before the next node on each of its levels
+		for(i = 0; i < traverse->height; i++)
+			update[i] = traverse;
+		traverse = traverse->next[0];
 	}
 
 	printf("Item was not found\n");
@@ -188,15 +187,15 @@ int SLRemove(SortedListPtr list, void *newObj){
 }
 
 SortedListIteratorPtr SLCreateIterator(SortedListPtr list){
-	if(list == NULL || list->head == NULL){ //list must be initialized and have at least one item
+	if(list == NULL || list->head[0] == NULL){ //list must be initialized and have at least one item
 		printf("List was either not allocated, or is empty, cannot create a pointer to it\n");
 		return NULL;
 	}
 
 	//create a space in memory for the the iterator make it point to head
 	SortedListIteratorPtr iterator = (SortedListIteratorPtr) malloc(sizeof(struct SortedListIterator));
-	iterator->currentNode = list->head;
-	list->head->numPointers++; //increment numofpointers pointing to head
+	iterator->currentNode = list->head[0];
+	list->head[0]->numPointers++; //increment numofpointers pointing to head
 
 	return iterator;
 }
@@ -218,11 +217,10 @@ void *SLNextItem(SortedListIteratorPtr iter){ //make sure all those cases are ta
 		return NULL; //check for null will terminate a loop in case it is used
 	else{
 		if(iter->currentNode->isValid){ //node was not removed while this pointer pointed to it
-			void * dataReturned = malloc(sizeof(iter->currentNode->data));
-			dataReturned = iter->currentNode->data; //save the data the iterator is pointing to
+			void * dataReturned = iter->currentNode->data; //save the data the iterator is pointing to
 			iter->currentNode->numPointers--; //decrement curent node's # of pointers
-			iter->currentNode = iter->currentNode->next; //update the iterator
-			if(iter->currentNode != NULL) 
+			iter->currentNode = iter->currentNode->next[0]; //update the iterator
+			if(iter->currentNode != NULL)
 				iter->currentNode->numPointers++; //now that the iterator was incremented we can update the number of iterators pointing to the new node (assuming it is not outside of the list)
 			return dataReturned;
 		}
@@ -230,8 +228,8 @@ void *SLNextItem(SortedListIteratorPtr iter){ //make sure all those cases are ta
 			iter->currentNode->numPointers--;
 			//remove function acts as a garbage collection and will take care of this node if there are no pointers pointing to it
 
-			iter->currentNode = iter->currentNode->next;
-			if(iter->currentNode != NULL) 
+			iter->currentNode = iter->currentNode->next[0];
+			if(iter->currentNode != NULL)
 				iter->currentNode->numPointers++;
 
 			return SLNextItem(iter); //does the same with the next token
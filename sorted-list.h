@@ -29,15 +29,20 @@
 typedef int (*CompareFuncT)( void *, void * );
 typedef void (*DestructFuncT)( void * );
 
+#define SL_MAX_LEVEL 16 //levels a list can have, enough for about 4^16 items
+
 /*
-* Linked list will be used to store the data of unknown type
+* Skip list will be used to store the data of unknown type
+* every node is on level 0, a node on one level is also on the next one up with probability 1/4,
+* searches start on the highest level and drop a level whenever the next node is too far
 */
 struct Node
 {
 	void * data;
-	struct Node * next;
 	int numPointers; //a counter that keeps track if pointers are pointing to this node, can only free if no pointers
 	bool isValid; //assuming the node was deleted, if it had pointers looking at it we can just say it is "not valid" and ignore it until all pointers are free'd
+	int height; //number of levels the node is on
+	struct Node * next[]; //next node on each of its levels, next[0] walks the whole list
 };
 typedef struct Node* NodePtr;
 
@@ -46,7 +51,9 @@ typedef struct Node* NodePtr;
  */
 struct SortedList
 {
-	NodePtr head;
+	NodePtr head[SL_MAX_LEVEL]; //first node on each level, head[0] is the first item
+	int level; //levels currently in use
+	unsigned int seed; //state for picking the height of new nodes
 	CompareFuncT comparator;
 	DestructFuncT destroyer;
 };
@@ -0,0 +1,61 @@
+#include <sched.h>
+#include "workpool.h"
+
+/*
+ * Turns of tasks that share one worker
+ *
+ * Two tasks run on a pool with a single worker and each yields itself back to
+ * the pool at the end of its turn, as runCategory does with a category that
+ * still has orders. The first turn of the first task waits until the second
+ * one is queued, from then on their turns must alternate.
+ *
+ * exits 1 if one task runs twice while the other is waiting
+ */
+
+#define NUM_TURNS 50 //turns each task takes
+
+struct turn_task{
+	char name;
+	int turns;
+};
+
+struct worker_pool pool;
+atomic_int bothQueued;
+atomic_int numDone;
+char order[2 * NUM_TURNS + 1]; //the name of every task that ran, in the order they ran
+int numRun;
+
+void takeTurn(void *task){
+	struct turn_task *turnTask = (struct turn_task *) task;
+
+	while(atomic_load(&bothQueued) == 0)
+		sched_yield();
+	order[numRun++] = turnTask->name;
+	if(++turnTask->turns < NUM_TURNS)
+		yieldTask(&pool, turnTask);
+	else
+		atomic_fetch_add(&numDone, 1);
+}
+
+int main(void){
+	struct turn_task first = { 'A', 0 }, second = { 'B', 0 };
+	struct wait_policy policy = { 0, 0 };
+	int i;
+
+	startWorkers(&pool, 1, 2, takeTurn, &policy);
+	submitTask(&pool, &first);
+	submitTask(&pool, &second);
+	atomic_store(&bothQueued, 1);
+	while(atomic_load(&numDone) < 2)
+		sched_yield();
+	stopWorkers(&pool);
+
+	for(i = 1; i < numRun; i++){
+		if(order[i] == order[i - 1]){
+			fprintf(stderr, "turns: %c ran twice in a row at turn %d: %s\n", order[i], i, order);
+			return 1;
+		}
+	}
+	printf("turns: %d turns alternated\n", numRun);
+	return 0;
+}
@@ -3,48 +3,109 @@
 /**
  * GLOBAL VARIABLES: Shared accross all threads
  *
- * lockAcceptedList: locks the global list of accepted sales while a thread is updating it
+ * customerLocks: without ATOMIC_BALANCES, lock a customer's balance while it is checked and updated,
+ * customers are spread over CUSTOMER_STRIPES locks by id so orders for different customers go ahead
+ * in parallel. With it balances are debited lock free, the customer table itself is only read while consumers run
  *
- * lockRejectedList: locks the global list of rejected sales while a thread is updating it
- *
- * lockConsumerDB: locks the customer database when updating customers funds
+ * lockReport: when following, consumers hold it shared while they apply a batch and writeReport
+ * holds it exclusively so a report never shows a debit without its sale
  * 
  * numFinishedConsumers: allows each consumer to work individually
  * without hogging the resources, while still avoiding a race. Main thread
  * waits until all consumers are done before printing out a report of the sales
  *
- * producerFinished: tells the consumers when the producer has finished
- * reading the file so that when the buffer is empty they know they are finisihed
+ * The category buffers are closed by main once every producer has been joined,
+ * a consumer stops once its buffer is closed and empty
  *
- * acceptedSales: list of accepted sales sorted by customer id
+ * chunkToPublish: the chunk of orders.txt whose producer may currently add orders to the buffers,
+ * producers parse their chunks in parallel but publish them in file order
  *
- * rejectedSales: list of accepted sales sorted by customer id
+ * producers: the producer threads, each one reads every numProducers-th chunk of orders.txt
  *
- * customerHash_t: a global database of all the customers listed in database.txt
+ * customerTable: a global database of all the customers listed in database.txt, built by setup
+ * and only read afterwards apart from the balances
  * 
  * buffHash_t: a global hash of the categories as the key and the address to their buffer as the value
+ *
+ * ordersMap: orders.txt mapped into memory, the producers tokenize it in place
+ *
+ * titlePool: every distinct book title, orders and sales share the interned copy
+ *
+ * categoryPool: the categories from categories.txt, a category's id indexes categoryShards
+ *
+ * categoryRouter: perfect hash over the categories, producers find an order's category with it
+ *
+ * categoryShards: the shards a category's orders are split into by customer id, most categories have one,
+ * a shard is a buffer in shardBuffers and its consumer in shardTasks, numShards counts them all
+ *
+ * workers: the consumer thread pool, numWorkers threads run the categories' tasks
+ *
+ * customerSnapshot: the customer snapshot mapping when the database was loaded from one,
+ * the strings of the customers in customerTable then live inside it
+ *
+ * customerArenas: otherwise the strings of the customers live here, one arena per loader thread
+ *
+ * defaultCapacity: capacity of a category buffer whose line in categories.txt does not give one
+ *
+ * bufferBudget: slots all category buffers may hold together in adaptive mode, 0 when buffers never grow,
+ * bufferSlots counts the slots they hold now
+ *
+ * waitPolicy: how long a producer facing a full buffer and an idle worker spin and yield before sleeping
+ *
+ * followMode: the producer keeps watching orders.txt for appended lines instead of stopping at the end,
+ * main writes reports on reportInterval or SIGUSR1 until SIGINT/SIGTERM sets stopFollowing
  */
 
-pthread_mutex_t lockAcceptedList = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t lockRejectedList = PTHREAD_MUTEX_INITIALIZER;
 
-pthread_mutex_t lockConsumerDB = PTHREAD_MUTEX_INITIALIZER;
+pthread_mutex_t customerLocks[CUSTOMER_STRIPES];
+pthread_rwlock_t lockReport;
 
 pthread_mutex_t lockConsumerCount = PTHREAD_MUTEX_INITIALIZER;
 pthread_cond_t consumerCountCond = PTHREAD_COND_INITIALIZER;
 int numFinishedConsumers;
 int numCategories;
+int numShards;
 
 pthread_mutex_t lockProducerFlag = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t producerEndCond = PTHREAD_COND_INITIALIZER;
-int producerFinished;
 
-SortedListPtr acceptedSales;
-SortedListPtr rejectedSales;
+pthread_mutex_t lockPublishTurn = PTHREAD_MUTEX_INITIALIZER;
+pthread_cond_t publishTurnCond = PTHREAD_COND_INITIALIZER;
+long chunkToPublish;
+
+int numProducers;
+producerPtr producers;
+long orderChunkSize;
+long numOrderChunks;
+
 
-customerHashPtr customerHash_t;
+struct customer_table customerTable;
 bufferHashPtr buffHash_t;
 
+struct mapped_file ordersMap = {NULL, 0, -1};
+
+struct string_pool titlePool;
+struct string_pool categoryPool;
+struct perfect_hash categoryRouter;
+struct category_shards *categoryShards;
+orderBufferPtr *shardBuffers;
+struct category_task *shardTasks;
+int defaultShards;
+struct worker_pool workers;
+int numWorkers;
+struct mapped_file customerSnapshot = {NULL, 0, -1};
+struct arena *customerArenas;
+int numCustomerArenas;
+
+int defaultCapacity;
+long bufferBudget;
+atomic_long bufferSlots;
+struct wait_policy waitPolicy;
+
+int followMode;
+int reportInterval;
+char *ordersPath;
+int stopFollowing;
+
 /**
  * End of global variables
  */
@@ -58,40 +119,136 @@ long getFileSize(FILE *fp){
     return fileSize;
 }
 
-int main(int  argc, char **argv){ 
-    if(argc != 4){
+int main(int  argc, char **argv){
+    int opt;
+
+    //-p <n>: split orders.txt into ranges read by n producers
+    //-f: follow orders.txt as it grows, -r <seconds>: write a report every so often while following
+    //-b <n>: default category buffer capacity, -a <KB>: grow busy buffers within a memory budget
+    //-w <n>: consumer threads, one per core by default
+    //-s <n>: split every category into n shards by customer id, categories.txt can set it per category
+    //-y <spins>[,<yields>]: how long a full producer or an idle consumer spins and yields before sleeping
+    numProducers = 1;
+    defaultShards = 1;
+    numWorkers = sysconf(_SC_NPROCESSORS_ONLN);
+    followMode = 0;
+    reportInterval = 0;
+    defaultCapacity = MAXBUFSIZE;
+    bufferBudget = 0;
+    initWaitPolicy(&waitPolicy);
+    while((opt = getopt(argc, argv, "p:fr:b:a:w:s:y:")) != -1){
+        if(opt == 'p' && atoi(optarg) > 0){
+            numProducers = atoi(optarg);
+        }
+        else if(opt == 'w' && atoi(optarg) > 0){
+            numWorkers = atoi(optarg);
+        }
+        else if(opt == 's' && atoi(optarg) > 0){
+            defaultShards = atoi(optarg);
+        }
+        else if(opt == 'b' && atoi(optarg) > 0){
+            defaultCapacity = atoi(optarg);
+        }
+        else if(opt == 'a' && atol(optarg) > 0){
+            bufferBudget = atol(optarg) * 1024 / SLOT_BYTES;
+        }
+        else if(opt == 'y' && parseWaitPolicy(optarg, &waitPolicy) == 0){
+            //parsed straight into waitPolicy
+        }
+        else if(opt == 'f'){
+            followMode = 1;
+        }
+        else if(opt == 'r' && atoi(optarg) > 0){
+            reportInterval = atoi(optarg);
+        }
+        else{
+            printf("Usage: %s [-p producers] [-w workers] [-s shards] [-b capacity] [-a budgetKB] [-y spins[,yields]] [-f [-r seconds]] database orders categories\n", argv[0]);
+            exit(1);
+        }
+    }
+
+    //appended lines arrive one at a time, there is nothing to split between producers
+    if(followMode && numProducers > 1){
+        printf("Follow mode reads orders with a single producer.\n");
+        numProducers = 1;
+    }
+
+    if(argc - optind != 3){
         printf("Illegal number of args.\n");
         printf("Exiting.\n");
         exit(1);
     }
     else{
-        char *db_file = argv[1];
-        char *order_file = argv[2];
-        char *categ_file = argv[3];
-        pthread_t producer_tid;
+        char *db_file = argv[optind];
+        char *order_file = argv[optind+1];
+        char *categ_file = argv[optind+2];
         const char *reportFileName = "finalreport.txt";
+        sigset_t followSignals;
+        int i;
 
         setup(db_file, categ_file);
+        openOrders(order_file);
+
+        //block the report and stop signals before any thread starts, every thread inherits
+        //the mask so they are only ever picked up by main in followReports
+        if(followMode){
+            sigemptyset(&followSignals);
+            sigaddset(&followSignals, SIGUSR1);
+            sigaddset(&followSignals, SIGINT);
+            sigaddset(&followSignals, SIGTERM);
+            pthread_sigmask(SIG_BLOCK, &followSignals, NULL);
+        }
+
+        //start the consumers first, producers schedule categories with them as soon as they add orders
+        //a shard only ever runs on one worker at a time, more workers than shards would idle
+        shardTasks = (struct category_task *) calloc(numShards, sizeof(struct category_task));
+        for(i = 0; i < numShards; i++){
+            shardTasks[i].buffer = shardBuffers[i];
+            atomic_init(&shardTasks[i].scheduled, 0);
+            initSaleRun(&shardTasks[i].accepted);
+            initSaleRun(&shardTasks[i].rejected);
+        }
+        if(numWorkers > numShards)
+            numWorkers = numShards;
+        if(numWorkers < 1)
+            numWorkers = 1;
+        startWorkers(&workers, numWorkers, numShards, runCategory, &waitPolicy);
+
+        //create producers to read the file
+        producers = (producerPtr) calloc(numProducers, sizeof(struct producer_struct));
+        for(i = 0; i < numProducers; i++){
+            producers[i].id = i;
+            producers[i].batches = (struct order_batch *) calloc(numShards, sizeof(struct order_batch));
+            pthread_create(&producers[i].tid, NULL, addNewOrder, &producers[i]);
+        }
 
-        //create producer to read file
-        pthread_create(&producer_tid, NULL, addNewOrder, order_file);
+        //while following, reports are written on demand until told to stop
+        if(followMode)
+            followReports(reportFileName, &followSignals);
 
-        //create consumers, send them the location of the buffers
-        bufferHashPtr traverse;
-        for(traverse = buffHash_t; traverse!=NULL; traverse=(bufferHashPtr)(traverse->hh.next)){
-            pthread_create(&traverse->buffer_value->tid, NULL, processOrder, traverse->buffer_value);
+        //the producers schedule categories with the pool until their last order,
+        //they are joined before the pool and the buffers can be torn down
+        for(i = 0; i < numProducers; i++)
+            pthread_join(producers[i].tid, NULL);
+
+        //the whole order file has been published, closing wakes each consumer once
+        //and it leaves as soon as its buffer is drained
+        for(i = 0; i < numShards; i++){
+            closeOrderBuffer(shardBuffers[i]);
+            scheduleCategory(&shardTasks[i]);
         }
 
         //Wait for all the consumers to process all their orders
         //Avoids race condition
         pthread_mutex_lock(&lockConsumerCount);
-        while(numFinishedConsumers != numCategories){
+        while(numFinishedConsumers != numShards){
             pthread_cond_wait(&consumerCountCond, &lockConsumerCount);
         }
         pthread_mutex_unlock(&lockConsumerCount);
+        stopWorkers(&workers);
 
         //once all consumers are done we can write the sale report
-        writeReport(reportFileName, acceptedSales, rejectedSales);
+        writeReport(reportFileName);
 
         cleanup();      
     }
@@ -101,73 +258,108 @@ int main(int  argc, char **argv){
 
 void setup(char *dbFile, char *categoriesFile){
     // parse files
-    FILE *db_fp; // database.txt
+    struct mapped_file db_map; // database.txt
     FILE *categories_fp; // categories.txt
     long fileSize;
-    TokenizerT *tk;
+    int stripe;
+    pthread_rwlockattr_t reportAttr;
 
     //set up global variables
     numFinishedConsumers = 0;
-    producerFinished = 0;
+    chunkToPublish = 0;
     numCategories = 0;
+    numShards = 0;
+    for(stripe = 0; stripe < CUSTOMER_STRIPES; stripe++)
+        pthread_mutex_init(&customerLocks[stripe], NULL);
+    //a steady stream of batches must not keep a follow mode report waiting forever
+    pthread_rwlockattr_init(&reportAttr);
+    pthread_rwlockattr_setkind_np(&reportAttr, PTHREAD_RWLOCK_PREFER_WRITER_NONRECURSIVE_NP);
+    pthread_rwlock_init(&lockReport, &reportAttr);
+    pthread_rwlockattr_destroy(&reportAttr);
 
     //setup global sales report lists
-    acceptedSales = SLCreate(compareSales, destroySales);
-    rejectedSales = SLCreate(compareSales, destroySales);
 
     //setup global hashes
-    customerHash_t = NULL;
     buffHash_t = NULL;
-
-    //setup customer database
-    if((db_fp = fopen(dbFile, "r")) == NULL){
+    initPool(&titlePool);
+    initPool(&categoryPool);
+    categoryShards = NULL;
+    shardBuffers = NULL;
+
+    //setup customer database, a fresh binary snapshot skips parsing database.txt altogether
+    if(loadSnapshot(dbFile, &customerSnapshot, &customerTable) == 0){
+        printf("Loaded %u customers from snapshot.\n", customerTable.count);
+    }
+    else if(mapFile(dbFile, &db_map, 0) < 0){
         perror("Error trying to open database file");
         printf("Program terminated.\n");
         cleanup();
         exit(1);
     }
     else{
-        fileSize = getFileSize(db_fp);
-        char buffer[fileSize];
-        char *name, *address, *state, *zip;
-        int customer_id;
-        float customer_funds;
-        customerPtr newCustomer;
+        struct customer_chunk *chunks;
+        int numChunks, i, j;
+        unsigned int numCustomers;
+        char *end;
 
         //must have customers in order to process the orders
-        if(fileSize == 0){
+        if(db_map.size == 0){
             printf("Customer file given was empty, please input another file.\n");
             printf("Program Exiting\n");
+            unmapFile(&db_map);
             cleanup();
             exit(1);
         }
 
-        while(fgets(buffer, fileSize, db_fp) != NULL){
-            tk = TKCreate("|", buffer);
-
-            while((name = TKGetNextToken(tk)) != NULL){
-                customer_id = atoi(TKGetNextToken(tk));
-                customer_funds = atof(TKGetNextToken(tk));
-                address = TKGetNextToken(tk);
-                state = TKGetNextToken(tk);
-                zip = TKGetNextToken(tk);
+        //one chunk per core, but never so small that starting a thread costs more than parsing
+        numChunks = sysconf(_SC_NPROCESSORS_ONLN);
+        if(numChunks > db_map.size / MIN_DB_CHUNK)
+            numChunks = db_map.size / MIN_DB_CHUNK;
+        if(numChunks < 1)
+            numChunks = 1;
+
+        //split the file into chunks that start at the beginning of a line
+        chunks = (struct customer_chunk *) calloc(numChunks, sizeof(struct customer_chunk));
+        customerArenas = (struct arena *) calloc(numChunks, sizeof(struct arena));
+        numCustomerArenas = numChunks;
+        end = db_map.data + db_map.size;
+        for(i = 0; i < numChunks; i++){
+            initArena(&customerArenas[i]);
+            chunks[i].strings = &customerArenas[i];
+            chunks[i].start = (i == 0) ? db_map.data : chunks[i-1].end;
+            chunks[i].end = (i == numChunks-1) ? end : nextLine(db_map.data + (db_map.size/numChunks)*(i+1) - 1, end);
+            if(chunks[i].end < chunks[i].start)
+                chunks[i].end = chunks[i].start;
+        }
 
-                trimExtras(name);
-                trimExtras(address);
-                trimExtras(state);
-                trimExtras(zip);
+        //parse the chunks in parallel, the calling thread takes the first one
+        for(i = 1; i < numChunks; i++)
+            pthread_create(&chunks[i].tid, NULL, loadCustomerChunk, &chunks[i]);
+        loadCustomerChunk(&chunks[0]);
 
-                newCustomer = (customerPtr) malloc(sizeof(struct CustomerStruct));
-                newCustomer->name = name;
-                newCustomer->address = address;
-                newCustomer->state = state;
-                newCustomer->zip = zip;
-                newCustomer->balance = customer_funds;
+        //the table is sized for every record up front so it never grows while it is filled
+        numCustomers = chunks[0].count;
+        for(i = 1; i < numChunks; i++){
+            pthread_join(chunks[i].tid, NULL);
+            numCustomers += chunks[i].count;
+        }
+        initCustomerTable(&customerTable, numCustomers);
 
-                addCustomer(customer_id, newCustomer, &customerHash_t);
+        //merge in file order so duplicate ids resolve exactly like a serial load, the first record wins
+        for(i = 0; i < numChunks; i++){
+            for(j = 0; j < chunks[i].count; j++){
+                addCustomer(&customerTable, chunks[i].ids[j], &chunks[i].customers[j]);
             }
+            free(chunks[i].ids);
+            free(chunks[i].customers);
         }
-        fclose(db_fp); //customer db is created so safe to close customer file
+        free(chunks);
+        finishCustomerTable(&customerTable);
+        unmapFile(&db_map); //customer db is created so safe to unmap customer file
+
+        //balances have not been touched yet, save the parsed database for the next run
+        if(writeSnapshot(dbFile, &customerTable) < 0)
+            perror("Warning: could not write customer snapshot");
     }
 
     //setup queues for each category
@@ -179,9 +371,11 @@ void setup(char *dbFile, char *categoriesFile){
     }else{
         fileSize = getFileSize(categories_fp);
         char line[fileSize];
-        char *category;
+        char *category, *bar;
         orderBufferPtr ob_buff;
-        int bufSize = MAXBUFSIZE;
+        internedPtr categoryName;
+        internedPtr *categoryNames = NULL; //every category, in order of id
+        int bufSize, shards, i;
 
         //if we are unable to create at least one consumer, we cant process orders
         if(fileSize == 0){
@@ -195,272 +389,616 @@ void setup(char *dbFile, char *categoriesFile){
             category = malloc(strlen(line)+1);
             strcpy(category, line);
 
+            //an optional capacity and shard count follow the name, NAME|capacity|shards,
+            //either may be left empty for the default
+            bufSize = defaultCapacity;
+            shards = defaultShards;
+            if((bar = strchr(category, '|')) != NULL){
+                *bar++ = '\0';
+                if(atoi(bar) > 0)
+                    bufSize = atoi(bar);
+                else if(*bar != '|' && *bar != '\n' && *bar != '\0')
+                    printf("Ignoring bad capacity for category %s\n", category);
+                if((bar = strchr(bar, '|')) != NULL){
+                    bar++;
+                    if(atoi(bar) > 0)
+                        shards = atoi(bar);
+                    else if(*bar != '|' && *bar != '\n' && *bar != '\0')
+                        printf("Ignoring bad shard count for category %s\n", category);
+                }
+            }
             trimExtras(category);
 
             //initialize a new buffer for each category and store it in a table such that:
             //KEY: category to VALUE: pointer to buffer
-            ob_buff = (orderBufferPtr) malloc(sizeof(struct orders_struct));
+            ob_buff = (orderBufferPtr) aligned_alloc(CACHE_LINE, sizeof(struct orders_struct));
             init_order_buf(ob_buff, bufSize);
-            addBuffer(category, ob_buff, &buffHash_t);
+            if(addBuffer(category, ob_buff, &buffHash_t) != 0){
+                //category listed twice, it already has a buffer and a consumer
+                kill_order_buf(ob_buff);
+                free(category);
+                continue;
+            }
+
+            //the producers route orders by the category's interned id, then by customer id among its shards
+            //the hash keeps the first shard's buffer, the others only live in shardBuffers
+            categoryName = intern(&categoryPool, category, strlen(category));
+            categoryShards = (struct category_shards *) realloc(categoryShards, poolSize(&categoryPool) * sizeof(struct category_shards));
+            categoryNames = (internedPtr *) realloc(categoryNames, poolSize(&categoryPool) * sizeof(internedPtr));
+            categoryNames[categoryName->id] = categoryName;
+            categoryShards[categoryName->id].first = numShards;
+            categoryShards[categoryName->id].count = shards;
+            shardBuffers = (orderBufferPtr *) realloc(shardBuffers, (numShards + shards) * sizeof(orderBufferPtr));
+            for(i = 0; i < shards; i++){
+                if(i > 0){
+                    ob_buff = (orderBufferPtr) aligned_alloc(CACHE_LINE, sizeof(struct orders_struct));
+                    init_order_buf(ob_buff, bufSize);
+                }
+                shardBuffers[numShards++] = ob_buff;
+                atomic_fetch_add(&bufferSlots, ob_buff->size);
+            }
             //increment the global variable numCategories
             numCategories++;
         }
         fclose(categories_fp); //category buffers initialized so safe to close category file
+
+        //the set of categories is fixed from here on
+        i = buildPerfectHash(&categoryRouter, categoryNames, numCategories);
+        free(categoryNames);
+        if(i < 0){
+            printf("Could not build the category routing table.\n");
+            printf("Program terminated\n");
+            cleanup();
+            exit(1);
+        }
+    }
+}
+
+//parses the customer records of one chunk of database.txt into the chunk's arrays
+//records are not added to the customer table here, setup merges the chunks in order
+void *loadCustomerChunk(void *args){
+    struct customer_chunk *chunk = (struct customer_chunk *) args;
+    char *line, *next;
+    TokenizerT tk;
+    TokenViewT name, id, funds, address, state, zip;
+    customerPtr newCustomer;
+
+    chunk->count = chunk->capacity = 0;
+    chunk->ids = NULL;
+    chunk->customers = NULL;
+
+    TKInitView(&tk, "|");
+    for(line = chunk->start; line < chunk->end; line = next){
+        next = nextLine(line, chunk->end);
+        TKSetText(&tk, line, next - line);
+
+        while(TKGetNextView(&tk, &name)){
+            if(!TKGetNextView(&tk, &id) || !TKGetNextView(&tk, &funds) || !TKGetNextView(&tk, &address)
+                || !TKGetNextView(&tk, &state) || !TKGetNextView(&tk, &zip))
+                break;
+
+            TKTrimView(&name);
+            TKTrimView(&address);
+            TKTrimView(&state);
+            TKTrimView(&zip);
+
+            if(chunk->count == chunk->capacity){
+                chunk->capacity = chunk->capacity ? chunk->capacity*2 : 1024;
+                chunk->ids = (int *) realloc(chunk->ids, chunk->capacity * sizeof(int));
+                chunk->customers = (struct CustomerStruct *) realloc(chunk->customers, chunk->capacity * sizeof(struct CustomerStruct));
+            }
+
+            //customers are kept until the report, so only here are the fields copied out
+            //the record itself is copied into the customer table by setup
+            newCustomer = &chunk->customers[chunk->count];
+            newCustomer->name = arenaDup(chunk->strings, name.start, name.length);
+            newCustomer->address = arenaDup(chunk->strings, address.start, address.length);
+            newCustomer->state = arenaDup(chunk->strings, state.start, state.length);
+            newCustomer->zip = arenaDup(chunk->strings, zip.start, zip.length);
+            newCustomer->balance = TKViewToCents(&funds);
+            chunk->ids[chunk->count] = TKViewToInt(&id);
+            chunk->count++;
+        }
     }
+    return NULL;
 }
 
-void writeReport(const char *filename, SortedListPtr accepted, SortedListPtr rejected){
+void writeReport(const char *filename){
     FILE *ofp;
-    if((ofp = fopen(filename, "w")) == NULL){
+    char tempName[strlen(filename) + 5];
+
+    //written beside the report and renamed over it, a report read while following is never half written
+    sprintf(tempName, "%s.tmp", filename);
+    if((ofp = fopen(tempName, "w")) == NULL){
         perror("Error opening output file");
         cleanup();
         exit(1);
     } 
     else{
         sale_reportPtr temp_aSale, temp_rSale; //pointers to the accepted sales and rejected sales
-        customerHashPtr printer;
+        saleRunPtr acceptedRuns[numShards], rejectedRuns[numShards];
+        struct sale_merge accepted, rejected; //the runs are merged, not consumed, so a report can be written again later
+        int shard, i;
+        customerSlotPtr printer;
+        unsigned int rank;
         int cid;
+        char price[CENTS_STRLEN], balance[CENTS_STRLEN]; //amounts are printed from integer cents
+
+        //consumers may still be running in follow mode, wait for the batches being applied
+        //and hold off new ones so no balance or list changes while it is written
+        pthread_rwlock_wrlock(&lockReport);
 
-        //since we aren't guaranteed a specific order of customers
-        sortHash(&customerHash_t, sort_customersByID);
+        //every shard kept its own runs, sorted by customer id they merge into one list each
+        for(shard = 0; shard < numShards; shard++){
+            acceptedRuns[shard] = &shardTasks[shard].accepted;
+            rejectedRuns[shard] = &shardTasks[shard].rejected;
+        }
+        //a category split into shards ties its sales by its orders' file order, as one run would
+        for(i = 0; i < numCategories; i++){
+            if(categoryShards[i].count > 1){
+                placeTiesAcrossRuns(&acceptedRuns[categoryShards[i].first], categoryShards[i].count);
+                placeTiesAcrossRuns(&rejectedRuns[categoryShards[i].first], categoryShards[i].count);
+            }
+            else{
+                sortSaleRun(acceptedRuns[categoryShards[i].first]);
+                sortSaleRun(rejectedRuns[categoryShards[i].first]);
+            }
+        }
+        initSaleMerge(&accepted, acceptedRuns, numShards);
+        initSaleMerge(&rejected, rejectedRuns, numShards);
 
-        for(printer = customerHash_t; printer!=NULL; printer=(customerHashPtr)(printer->hh.next)){
-            cid = printer->customer_key;
+        //customers in order of id, sorted once when the table was finished
+        for(rank = 0; rank < customerTable.count; rank++){
+            printer = customerByRank(&customerTable, rank);
+            cid = printer->customer_id;
             fprintf(ofp, "=== BEGIN CUSTOMER INFO ===\n");
             fprintf(ofp, "### BALANCE ###\n");
-            fprintf(ofp, "Customer name: %s\n", printer->customer_info->name);
+            fprintf(ofp, "Customer name: %s\n", printer->customer.name);
             fprintf(ofp, "Customer ID number: %d\n", cid);
-            fprintf(ofp, "Remaining credit balance after all purchases (a dollar amount): %.2f\n", printer->customer_info->balance);
+            formatCents(printer->customer.balance, balance);
+            fprintf(ofp, "Remaining credit balance after all purchases (a dollar amount): %s\n", balance);
             fprintf(ofp, "### SUCCESSFUL ORDERS ###\n");
 
-            while(accepted->head != NULL){
-                temp_aSale = (sale_reportPtr) accepted->head->data;
-
+            while((temp_aSale = peekMergedSale(&accepted)) != NULL){
                 if(cid != temp_aSale->customer_id)
                     break;
                 else{
-                    fprintf(ofp, "\"%s\"|%.2f|%.2f\n", temp_aSale->booktitle, temp_aSale->bookprice, temp_aSale->remaining_balance);
-                    accepted->head = accepted->head->next;
+                    formatCents(temp_aSale->bookprice, price);
+                    formatCents(temp_aSale->remaining_balance, balance);
+                    fprintf(ofp, "\"%s\"|%s|%s\n", temp_aSale->title->text, price, balance);
+                    nextMergedSale(&accepted);
                 }
             }
 
             fprintf(ofp, "### REJECTED ORDERS ###\n");
 
-            while(rejected->head != NULL){
-                temp_rSale = (sale_reportPtr) rejected->head->data;
-
+            while((temp_rSale = peekMergedSale(&rejected)) != NULL){
                 if(cid != temp_rSale->customer_id)
                     break;
                 else{
-                    fprintf(ofp, "\"%s\"|%.2f\n", temp_rSale->booktitle, temp_rSale->bookprice);
-                    rejected->head = rejected->head->next;
+                    formatCents(temp_rSale->bookprice, price);
+                    fprintf(ofp, "\"%s\"|%s\n", temp_rSale->title->text, price);
+                    nextMergedSale(&rejected);
                 }
             }
             fprintf(ofp, "=== END CUSTOMER INFO ===\n");
             fprintf(ofp, "\n");
         }
 
+        freeSaleMerge(&accepted);
+        freeSaleMerge(&rejected);
+        pthread_rwlock_unlock(&lockReport);
+
         //report file done
         fclose(ofp);
+        if(rename(tempName, filename) < 0)
+            perror("Error replacing report file");
     }
 } 
 
-//PRODUCER
-void *addNewOrder(void *args){
-    char *order_file = (char *) args;
-    FILE *order_fp;
+//writes reports while the producer follows orders.txt, on SIGUSR1 and every reportInterval seconds
+//returns once SIGINT or SIGTERM asks the program to stop, the producer then finishes up as usual
+void followReports(const char *filename, sigset_t *signals){
+    struct timespec interval = {reportInterval, 0};
+    int sig;
+
+    printf("Following orders, send SIGUSR1 for a report, SIGINT to stop.\n");
+    while(1){
+        if(reportInterval > 0)
+            sig = sigtimedwait(signals, NULL, &interval);
+        else
+            sig = sigwaitinfo(signals, NULL);
+
+        if(sig == SIGINT || sig == SIGTERM)
+            break;
+        if(sig == SIGUSR1 || (sig < 0 && errno == EAGAIN))
+            writeReport(filename);
+    }
 
-    //open order.txt file
-    if((order_fp = fopen(order_file, "r")) == NULL){
+    pthread_mutex_lock(&lockProducerFlag);
+    stopFollowing = 1;
+    pthread_mutex_unlock(&lockProducerFlag);
+}
+
+//maps orders.txt, the orders handed to the consumers point straight into it
+void openOrders(char *orderFile){
+    ordersPath = orderFile;
+    if(mapFile(orderFile, &ordersMap, 0) < 0){
         perror("Error trying to open orders file");
         printf("Program terminated\n");
         cleanup();
         exit(1);
     }
-    else{
-        char buffer[MAX_LINE_LEN];
-        TokenizerT *tk;
-        char *booktitle, *category;
-        float bookprice;
-        int customer_id, index;
-        orderBufferPtr orderBuffer;
-        orderInfoPtr oinf;
-
-        //if file of orders is empty there is nothing to do
-        if(getFileSize(order_fp) == 0){
-            printf("Orders file given was empty, please input another file.\n");
-            printf("Program Exiting\n");
-            cleanup();
-            exit(1);
+
+    //the followed file is read as it grows, it may well start out empty
+    if(followMode)
+        return;
+
+    //if file of orders is empty there is nothing to do
+    if(ordersMap.size == 0){
+        printf("Orders file given was empty, please input another file.\n");
+        printf("Program Exiting\n");
+        cleanup();
+        exit(1);
+    }
+
+    //a single producer reads the whole file as one range
+    if(numProducers == 1 || ordersMap.size / numProducers < MIN_ORDER_CHUNK)
+        orderChunkSize = ordersMap.size;
+    else
+        orderChunkSize = (ordersMap.size / numProducers < MAX_ORDER_CHUNK) ? ordersMap.size / numProducers : MAX_ORDER_CHUNK;
+    numOrderChunks = (ordersMap.size + orderChunkSize - 1) / orderChunkSize;
+}
+
+//returns the start of the first line at or after offset, so every chunk holds whole lines
+char *chunkBoundary(long offset){
+    if(offset <= 0)
+        return ordersMap.data;
+    if(offset >= ordersMap.size)
+        return ordersMap.data + ordersMap.size;
+    return nextLine(ordersMap.data + offset - 1, ordersMap.data + ordersMap.size);
+}
+
+//adds orders to the buffer of their category, waiting for the consumer while the buffer is full
+void publishOrders(int shard, struct info_t *orders, int n){
+    orderBufferPtr orderBuffer = shardBuffers[shard];
+    int added;
+
+    //the category is scheduled after every push, so a full buffer always has a worker draining it
+    while(n > 0){
+        if((added = tryPushOrders(orderBuffer, orders, n)) > 0){
+            scheduleCategory(&shardTasks[shard]);
+        }
+        else{
+            //a buffer that keeps stalling the producer is too small for its category
+            if(bufferBudget > 0 && ++orderBuffer->stalls >= GROW_STALLS && growBuffer(orderBuffer))
+                continue;
+            printf("Producer waiting for consumer\n");
+            waitForSpace(orderBuffer, &waitPolicy);
         }
+        orders += added;
+        n -= added;
+    }
+}
+
+int growBuffer(orderBufferPtr orderBuffer){
+    unsigned int oldSize = orderBuffer->size;
+    long slots = atomic_load(&bufferSlots);
+
+    orderBuffer->stalls = 0;
+
+    //reserve the extra slots first so producers growing different buffers never overshoot the budget
+    do{
+        if(slots + oldSize > bufferBudget)
+            return 0;
+    }while(!atomic_compare_exchange_weak(&bufferSlots, &slots, slots + oldSize));
+
+    if(growOrderBuffer(orderBuffer, oldSize * 2) == 0){
+        atomic_fetch_sub(&bufferSlots, oldSize);
+        return 0;
+    }
+    printf("Producer grew a category buffer to %u orders\n", orderBuffer->size);
+    return 1;
+}
 
-        //we don't want this thread to slow the other threads down
-        //and we would also like to free resources after program is done
-        pthread_detach(pthread_self()); 
+//milliseconds from a coarse clock, cheap enough to read while parsing
+long batchClock(){
+    struct timespec now;
 
-        while(fgets(buffer, MAX_LINE_LEN, order_fp) != NULL){
-            printf("Producer is adding a new sale.\n");
-            tk = TKCreate("|", buffer);
-            while((booktitle = TKGetNextToken(tk)) != NULL){
-                bookprice = atof(TKGetNextToken(tk));
-                customer_id = atoi(TKGetNextToken(tk));
-                category = TKGetNextToken(tk);
+    clock_gettime(CLOCK_MONOTONIC_COARSE, &now);
+    return now.tv_sec * 1000 + now.tv_nsec / 1000000;
+}
 
-                trimExtras(booktitle);
-                trimExtras(category);
+void batchOrder(producerPtr producer, int shard, const struct info_t *oinf){
+    struct order_batch *batch = &producer->batches[shard];
+
+    if(batch->count == 0)
+        batch->started = batchClock();
+    batch->orders[batch->count++] = *oinf;
+    if(batch->count == ORDER_BATCH){
+        publishOrders(shard, batch->orders, batch->count);
+        batch->count = 0;
+    }
+}
 
-                //get the buffer of that category
-                orderBuffer = getBuffer(category, &buffHash_t);
+void flushBatches(producerPtr producer, int all){
+    long now = all ? 0 : batchClock();
+    int i;
 
-                //checks invalid category
-                if(orderBuffer == NULL)
-                    continue;
+    for(i = 0; i < numShards; i++){
+        if(producer->batches[i].count == 0)
+            continue;
+        if(all || now - producer->batches[i].started >= BATCH_TIMEOUT_MS){
+            publishOrders(i, producer->batches[i].orders, producer->batches[i].count);
+            producer->batches[i].count = 0;
+        }
+    }
+}
 
-                //lock the buffer
-                pthread_mutex_lock(&orderBuffer->mutex);
+//every order of a customer in a category goes to the same shard, so it is applied in file order
+int routeOrder(int category, int customer_id){
+    struct category_shards *shards = &categoryShards[category];
 
-                //while the buffer is full call the consumer of that buffer
-                while(orderBuffer->count == orderBuffer->size){
-                    pthread_cond_signal(&orderBuffer->dataAvailable);
-                    printf("Producer waiting for consumer\n");
-                    pthread_cond_wait(&orderBuffer->spaceAvailable, &orderBuffer->mutex);
+    if(shards->count == 1)
+        return shards->first;
+    //multiplicative hash, consecutive ids spread over the shards
+    return shards->first + (int)(((uint32_t) customer_id * 2654435761u) % shards->count);
+}
+
+//parses the whole lines between start and end and hands each order to its category's buffer
+//orders are batched for publishing right away when publishNow is set, otherwise staged in the producer
+void parseOrders(producerPtr producer, char *start, char *end, int publishNow){
+    char *line, *next;
+    TokenizerT tk;
+    TokenViewT booktitle, price, id, category;
+    struct info_t oinf; //copied into a batch or the staged orders, then into a ring slot
+    internedPtr categoryName;
+    int shard;
+    long lines = 0;
+
+    TKInitView(&tk, "|");
+    for(line = start; line < end; line = next){
+        next = nextLine(line, end);
+        //a category with few orders should not wait for its batch to fill
+        if(publishNow && ++lines % BATCH_CHECK_LINES == 0)
+            flushBatches(producer, 0);
+        printf("Producer is adding a new sale.\n");
+        TKSetText(&tk, line, next - line);
+        while(TKGetNextView(&tk, &booktitle)){
+            if(!TKGetNextView(&tk, &price) || !TKGetNextView(&tk, &id) || !TKGetNextView(&tk, &category))
+                break;
+
+            TKTrimView(&booktitle);
+            TKTrimView(&category);
+
+            //get the buffer of that category, one hash and one compare
+            categoryName = perfectLookup(&categoryRouter, category.start, category.length);
+
+            //checks invalid category
+            if(categoryName == NULL)
+                continue;
+
+            //initialize new order
+            init_newOrder(&oinf, TKViewToInt(&id), intern(&titlePool, booktitle.start, booktitle.length), TKViewToCents(&price),
+                booktitle.start - ordersMap.data);
+            shard = routeOrder(categoryName->id, oinf.customer_id);
+
+            if(publishNow){
+                batchOrder(producer, shard, &oinf);
+            }
+            else{
+                if(producer->numStaged == producer->stagedCapacity){
+                    producer->stagedCapacity = producer->stagedCapacity ? producer->stagedCapacity*2 : 1024;
+                    producer->staged = (struct staged_order *) realloc(producer->staged, producer->stagedCapacity * sizeof(struct staged_order));
                 }
- 
-                index = (orderBuffer->rear++)%(orderBuffer->size);
-                //initialize new order and add to buffer
-                oinf = init_newOrder(customer_id, booktitle, bookprice);
-                orderBuffer->buf[index] = oinf;
-                orderBuffer->count++;
-
-                pthread_cond_signal(&orderBuffer->dataAvailable);
-                pthread_mutex_unlock(&orderBuffer->mutex);
-                //unlock mutex
+                producer->staged[producer->numStaged].shard = shard;
+                producer->staged[producer->numStaged].order = oinf;
+                producer->numStaged++;
             }
         }
+    }
+}
 
-    //at this point producer reached the end of the orders text file
-    //so producer can close the order file and safely exit
-    fclose(order_fp);
+//reads orders.txt as it grows until followReports sets stopFollowing
+//only complete lines are read, a line still being written waits for its newline
+void followOrders(producerPtr producer){
+    struct pollfd watch;
+    char events[4096];
+    size_t consumed = 0;
+    int stopping = 0;
+
+    //without inotify the file is still followed, just checked every FOLLOW_POLL_MS
+    watch.fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    watch.events = POLLIN;
+    if(watch.fd < 0 || inotify_add_watch(watch.fd, ordersPath, IN_MODIFY) < 0)
+        perror("Warning: could not watch orders file");
+
+    while(!stopping){
+        //the last pass after the stop request picks up whatever was appended before it
+        stopping = checkStopFollowing();
+
+        if(remapFile(&ordersMap) < 0){
+            perror("Error rereading orders file");
+            break;
+        }
+        if(ordersMap.size < consumed){
+            printf("Orders file was truncated, reading it from the start.\n");
+            consumed = 0;
+        }
 
-    //warn consumers that producer has finished reading order file
-    pthread_mutex_lock(&lockProducerFlag);
-    producerFinished = 1;
-    pthread_mutex_unlock(&lockProducerFlag);
+        if(ordersMap.data != NULL){
+            char *end = lastLineEnd(ordersMap.data + consumed, ordersMap.data + ordersMap.size);
+            parseOrders(producer, ordersMap.data + consumed, end, 1);
+            consumed = end - ordersMap.data;
+        }
+        //nothing is held back while waiting for more lines
+        flushBatches(producer, 1);
+
+        //wait for the file to change, waking up now and then to notice a stop request
+        if(!stopping && poll(&watch, 1, FOLLOW_POLL_MS) > 0){
+            while(read(watch.fd, events, sizeof(events)) > 0);
+        }
     }
 
-    pthread_mutex_lock(&lockConsumerCount);
-    int consCountCopy = numFinishedConsumers;
-    pthread_mutex_unlock(&lockConsumerCount);
-    bufferHashPtr temp;
+    if(watch.fd >= 0)
+        close(watch.fd);
+}
+
+//PRODUCER(S)
+void *addNewOrder(void *args){
+    producerPtr producer = (producerPtr) args;
+    long chunk;
+    int i, myTurn;
+
+    //chunks are dealt out round robin, producer i parses chunks i, i+numProducers, ...
+    //a followed file is not chunked, followOrders reads it as it grows
+    if(followMode)
+        followOrders(producer);
+    for(chunk = producer->id; chunk < numOrderChunks; chunk += numProducers){
+        //orders are published in file order: if an earlier chunk is still being
+        //published, park this chunk's orders until its turn comes
+        pthread_mutex_lock(&lockPublishTurn);
+        myTurn = (chunkToPublish == chunk);
+        pthread_mutex_unlock(&lockPublishTurn);
+        producer->numStaged = 0;
+
+        parseOrders(producer, chunkBoundary(chunk * orderChunkSize), chunkBoundary((chunk+1) * orderChunkSize), myTurn);
+        if(myTurn)
+            flushBatches(producer, 1);
+
+        //wait for the previous chunk to be published, then publish this one and pass the turn on
+        pthread_mutex_lock(&lockPublishTurn);
+        while(chunkToPublish != chunk){
+            pthread_cond_wait(&publishTurnCond, &lockPublishTurn);
+        }
+        pthread_mutex_unlock(&lockPublishTurn);
 
-    //release all threads waiting for the producer
-    while(consCountCopy < numCategories){      
-        for(temp = buffHash_t; temp!=NULL; temp=(bufferHashPtr)(temp->hh.next)){
-            pthread_cond_signal(&temp->buffer_value->dataAvailable);
+        //batching per category keeps each category's orders in file order
+        for(i = 0; i < producer->numStaged; i++){
+            batchOrder(producer, producer->staged[i].shard, &producer->staged[i].order);
         }
-        pthread_mutex_lock(&lockConsumerCount);
-        consCountCopy = numFinishedConsumers;
-        pthread_mutex_unlock(&lockConsumerCount);
+        flushBatches(producer, 1);
+
+        pthread_mutex_lock(&lockPublishTurn);
+        chunkToPublish++;
+        pthread_cond_broadcast(&publishTurnCond);
+        pthread_mutex_unlock(&lockPublishTurn);
     }
 
+    //at this point producer reached the end of its part of the orders file, orders only
+    //hold interned titles so nothing points into the mapping anymore
+
     printf("Producer exiting\n");
     pthread_exit(NULL);
 }
-// Used to check to see if the producer is finished reading database file
-// returns 1 if the producer is finished and closed the file
-// function used so that mutex isn't hogged throughout the entire iteration of the loop
-int checkProducerFlag(){
+// Used by the producer to check whether it should stop following the orders file
+int checkStopFollowing(){
     int flagcopy;
     pthread_mutex_lock(&lockProducerFlag);
-    flagcopy = producerFinished;
+    flagcopy = stopFollowing;
     pthread_mutex_unlock(&lockProducerFlag);
     return flagcopy;
 }
 
+pthread_mutex_t *customerLock(int customer_id){
+    return &customerLocks[(unsigned int) customer_id & (CUSTOMER_STRIPES - 1)];
+}
+
+void scheduleCategory(struct category_task *category){
+    int idle = 0;
+
+    //cheap check first, the category is usually already queued while orders keep coming
+    if(atomic_load(&category->scheduled) == 0 && atomic_compare_exchange_strong(&category->scheduled, &idle, 1))
+        submitTask(&workers, category);
+}
+
+void rescheduleCategory(struct category_task *category){
+    int idle = 0;
+
+    if(atomic_load(&category->scheduled) == 0 && atomic_compare_exchange_strong(&category->scheduled, &idle, 1))
+        yieldTask(&workers, category);
+}
+
 //CONSUMER(S)
-void *processOrder(void *args){
-    orderBufferPtr orders = (orderBufferPtr) args;
-    orderInfoPtr *oinfbuf = orders->buf;
+void runCategory(void *args){
+    struct category_task *category = (struct category_task *) args;
+    orderBufferPtr orders = category->buffer;
     
-    orderInfoPtr item;
-    int customer_id, index;
-    char *booktitle; //bookname
-    float bookprice;
+    struct info_t items[ORDER_BATCH]; //copied out of the ring, its slots are free again
+    int numItems, i, turn, finished;
+    int customer_id;
+    internedPtr booktitle; //bookname
+    int64_t bookprice, balance; //in cents
     customerPtr c_info;
-    sale_reportPtr report;
-
-    //we don't want this thread to slow the other threads down
-    //and we would also like to free resources after program is done
-    pthread_detach(pthread_self()); 
-
-    //while producer is not done reading the file
-    while(!checkProducerFlag()){
-        pthread_mutex_lock(&orders->mutex);
-        //if buffer is empty call on producer
-        while(orders->count == 0){
-            pthread_cond_signal(&orders->spaceAvailable);
-            printf("Consumer (%x) waiting for producer\n", (unsigned int) pthread_self());
-            //if producer was done and the buffer is empty, we can leave
-            if(checkProducerFlag()){
-                pthread_mutex_unlock(&orders->mutex);
-                pthread_mutex_lock(&lockConsumerCount);
-                numFinishedConsumers++;
-                pthread_cond_signal(&consumerCountCond);
-                pthread_mutex_unlock(&lockConsumerCount);
-                printf("Consumer (%x) exiting\n", (unsigned int) pthread_self());
-                pthread_exit(NULL);
-            }
-            pthread_cond_wait(&orders->dataAvailable, &orders->mutex);
-        }
-
-        //process all items in this buffer
-        while(orders->count > 0){
+#ifndef ATOMIC_BALANCES
+    pthread_mutex_t *lock;
+#endif
+    int accepted;
+
+    //a bounded turn, a busy category cannot keep a worker from the others
+    //orders are taken out a batch at a time without locking the buffer
+    for(turn = 0; turn < CATEGORY_TURN; turn++){
+        if((numItems = tryPopOrders(orders, items, ORDER_BATCH)) == 0)
+            break;
+
+        //a report waits until the whole batch is applied, only following writes
+        //reports while consumers run
+        if(followMode)
+            pthread_rwlock_rdlock(&lockReport);
+        for(i = 0; i < numItems; i++){
             printf("Consumer (%x) is processing a sale\n", (unsigned int) pthread_self());
-            index = (orders->front++)%(orders->size);
-            orders->count--;
-            item = oinfbuf[index];
-            customer_id = item->customer_id;
-            booktitle = item->book_name;
-            bookprice = item->bookprice;
-
-            //update customer's funds
-            pthread_mutex_lock(&lockConsumerDB);
-            c_info = getCustomer(customer_id, &customerHash_t);
-
-            //process order only if customer exists
-            if(c_info != NULL && (c_info->balance - bookprice) >= 0){
-                //deduct from his balance and add to acceptedOrders list
-                c_info->balance -= bookprice;
-                pthread_mutex_lock(&lockAcceptedList);
-                report = createNewSale(customer_id, booktitle, bookprice, c_info->balance);
-                SLInsert(acceptedSales, report);
-                pthread_mutex_unlock(&lockAcceptedList);
-            }
-            else if(c_info != NULL && (c_info->balance - bookprice) < 0){
-                //add to rejectedOrders
-                pthread_mutex_lock(&lockRejectedList);
-                report = createNewSale(customer_id, booktitle, bookprice, c_info->balance);
-                SLInsert(rejectedSales, report);
-                pthread_mutex_unlock(&lockRejectedList);
-            }
-            else if(c_info == NULL){
+            customer_id = items[i].customer_id;
+            booktitle = items[i].title;
+            bookprice = items[i].bookprice;
+
+            //the table is not changed while consumers run, only the balance is written
+            c_info = getCustomer(&customerTable, customer_id);
+            if(c_info == NULL){
                 printf("CustomerID %d was not found in the database\n", customer_id);
+                continue;
             }
-            pthread_mutex_unlock(&lockConsumerDB);
 
-            pthread_cond_signal(&orders->spaceAvailable);
-            pthread_mutex_unlock(&orders->mutex);
+            //update customer's funds, the sale is recorded with the balance the debit left
+#ifdef ATOMIC_BALANCES
+            accepted = debitBalance(c_info, bookprice, &balance);
+#else
+            lock = customerLock(customer_id);
+            pthread_mutex_lock(lock);
+            accepted = debitBalance(c_info, bookprice, &balance);
+            pthread_mutex_unlock(lock);
+#endif
+
+            //only one worker runs a shard at a time, its runs need no lock
+            if(accepted)
+                appendSale(&category->accepted, customer_id, booktitle, bookprice, balance, items[i].position);
+            else
+                appendSale(&category->rejected, customer_id, booktitle, bookprice, balance, items[i].position);
         }
+        if(followMode)
+            pthread_rwlock_unlock(&lockReport);
     }
 
-    //incase flag was updated before the list was empty
-    pthread_mutex_lock(&lockConsumerCount);
-    numFinishedConsumers++;
-    pthread_mutex_unlock(&lockConsumerCount);
-    pthread_cond_signal(&consumerCountCond);
-    
-    printf("Consumer (%x) exiting\n", (unsigned int) pthread_self());
-    pthread_exit(NULL);
+    //the producers closed the buffer and it is empty, this category is done
+    if(!category->finished && orderBufferDrained(orders)){
+        category->finished = 1;
+        //sorted now, while other categories still run, so the final report only merges
+        sortSaleRun(&category->accepted);
+        sortSaleRun(&category->rejected);
+        pthread_mutex_lock(&lockConsumerCount);
+        numFinishedConsumers++;
+        pthread_cond_signal(&consumerCountCond);
+        pthread_mutex_unlock(&lockConsumerCount);
+        printf("Consumer (%x) finished a category\n", (unsigned int) pthread_self());
+    }
+    finished = category->finished;
+
+    //end the turn, then look again: orders added before the flag was cleared would
+    //otherwise wait for a producer that already saw the category as scheduled
+    //the category goes behind the ones already waiting, the worker's own deque would
+    //hand it straight back to this worker
+    atomic_store(&category->scheduled, 0);
+    if(!finished && orderBufferReady(orders))
+        rescheduleCategory(category);
 }
 
 /*
@@ -489,19 +1027,61 @@ void trimExtras(char *text){
 
 //free allocated memory upon exit
 void cleanup(){
-    clearCustomerHash(&customerHash_t);
+    stopWorkers(&workers);
+    clearCustomerTable(&customerTable);
+    unmapFile(&customerSnapshot);
+    if(customerArenas != NULL){
+        int i;
+        for(i = 0; i < numCustomerArenas; i++)
+            freeArena(&customerArenas[i]);
+        free(customerArenas);
+        customerArenas = NULL;
+    }
     clearBufferHash(&buffHash_t);
-    SLDestroy(acceptedSales);
-    SLDestroy(rejectedSales);
+    if(categoryShards != NULL){
+        int i, j;
+        for(i = 0; i < numCategories; i++){
+            for(j = 1; j < categoryShards[i].count; j++)
+                kill_order_buf(shardBuffers[categoryShards[i].first + j]);
+        }
+    }
+    unmapFile(&ordersMap);
+    destroyPool(&titlePool);
+    freePerfectHash(&categoryRouter);
+    destroyPool(&categoryPool);
+    free(categoryShards);
+    categoryShards = NULL;
+    free(shardBuffers);
+    shardBuffers = NULL;
+    if(shardTasks != NULL){
+        int i;
+        for(i = 0; i < numShards; i++){
+            freeSaleRun(&shardTasks[i].accepted);
+            freeSaleRun(&shardTasks[i].rejected);
+        }
+        free(shardTasks);
+        shardTasks = NULL;
+    }
+    if(producers != NULL){
+        int i;
+        for(i = 0; i < numProducers; i++){
+            free(producers[i].staged);
+            free(producers[i].batches);
+        }
+        free(producers);
+        producers = NULL;
+    }
 }
 
 //DEBUGGIN FUNCTIONS
 void SLPrint(SortedListPtr sl){
     SortedListIteratorPtr iter = SLCreateIterator(sl);
     sale_reportPtr data;
+    char remaining[CENTS_STRLEN];
     
     while((data = ((sale_reportPtr) SLNextItem(iter))) != NULL){
-        printf("Customer ID: %d, Booktitle: %s, Remaining: %4.2f\n", data->customer_id, data->booktitle, data->remaining_balance);
+        formatCents(data->remaining_balance, remaining);
+        printf("Customer ID: %d, Booktitle: %s, Remaining: %s\n", data->customer_id, data->title->text, remaining);
     }
 }
 
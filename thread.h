@@ -8,38 +8,158 @@
 #include <errno.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <signal.h>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/inotify.h>
 #include "hashmap.h"
+#include "custtable.h"
+#include "perfecthash.h"
 #include "order.h"
+#include "sales.h"
 #include "tokenizer.h"
 #include "sorted-list.h"
+#include "mapfile.h"
+#include "snapshot.h"
+#include "workpool.h"
 
-#define MAXBUFSIZE 10
-#define MAX_LINE_LEN 200 //change max line length if you think it can be longer
+#define MAXBUFSIZE 10 //default capacity of a category buffer, -b or categories.txt can change it
+#define GROW_STALLS 4 //times a producer finds a buffer full before growing it in adaptive mode
+#define SLOT_BYTES (sizeof(struct info_t)) //memory a buffer slot takes, the order is stored in it, for the -a budget
+#define MIN_DB_CHUNK (1 << 20) //smallest piece of database.txt worth its own loader thread
+#define MIN_ORDER_CHUNK (1 << 16) //smallest range of orders.txt worth handing to another producer
+#define MAX_ORDER_CHUNK (1 << 20) //largest range a producer parses before publishing, bounds what it holds back
+#define FOLLOW_POLL_MS 500 //longest a following producer sleeps before checking for a stop request
+#define ORDER_BATCH 8 //orders a producer collects per category before handing them over, and a consumer takes at once
+#define BATCH_TIMEOUT_MS 50 //longest an order waits in a producer's batch while the producer keeps parsing
+#define BATCH_CHECK_LINES 64 //lines parsed between checks for batches that waited too long
+#define CUSTOMER_STRIPES 256 //locks guarding customer balances, a customer id picks one, a power of 2
+#define CATEGORY_TURN 4 //batches a worker takes from one category before letting other categories run
+
+//an order parsed ahead of its turn, published once the chunks before it are
+struct staged_order{
+    int shard; //shard of the order's category it is routed to
+    struct info_t order;
+};
+
+//orders for one shard collected by a producer, handed to the buffer together
+struct order_batch{
+    struct info_t orders[ORDER_BATCH];
+    int count;
+    long started; //when the first order went in, in milliseconds
+};
+
+//a producer thread and the orders of the chunk it is holding back
+struct producer_struct{
+    pthread_t tid;
+    int id;
+    struct staged_order *staged;
+    int numStaged;
+    int stagedCapacity;
+    struct order_batch *batches; //one per shard
+};
+typedef struct producer_struct * producerPtr;
+
+//where a category's shards start in shardBuffers and shardTasks and how many it has
+struct category_shards{
+    int first;
+    int count;
+};
+
+//the consumer of one shard of a category, run by whichever pool worker picks it up
+struct category_task{
+    orderBufferPtr buffer;
+    atomic_int scheduled; //1 while queued in the pool or running, so one worker at a time drains the buffer in order
+    int finished; //buffer closed and drained, counted in numFinishedConsumers
+    struct sale_run accepted; //sales of this shard, merged with the other shards' by writeReport
+    struct sale_run rejected;
+};
+
+//a newline aligned piece of database.txt and the customers parsed out of it
+struct customer_chunk{
+    pthread_t tid;
+    char *start;
+    char *end;
+    int count;
+    int capacity;
+    int *ids;
+    struct CustomerStruct *customers;
+    arenaPtr strings; //the customers' strings, kept until cleanup
+};
 
 //sets up the environment so that the producer and consumers can process the orders
 //initializes a database of customer info from database.txt
 //initializes an empty buffer for each category from categories.txt
+//a line may give its category's buffer capacity and shard count after bars, SPORTS01|64|4
 void setup(char *dbFile, char *categoriesFile);
 
+// Loader thread used by setup, parses one customer_chunk of database.txt
+void *loadCustomerChunk(void *args);
+
 // Writes a report to finalreport.txt
 // Consists of a final summary for each customer
 // List of successful orders, rejected orders and total remaining balance
-void writeReport(const char *filename, SortedListPtr accepted, SortedListPtr rejected);
+void writeReport(const char *filename);
+
+// Writes the report on SIGUSR1 and every reportInterval seconds while following the orders file
+// returns when SIGINT or SIGTERM is received, after telling the producer to stop
+void followReports(const char *filename, sigset_t *signals);
 
-// free's allocated memory from buffer hash, customer hash and sorted lists
+// free's allocated memory from buffer hash, customer table and sale runs
 void cleanup();
 
-// **** PRODUCER ****
-// opens the orders file and adds sales to the appropriate category buffer
+// Maps the orders file and splits it into newline aligned chunks for the producers
+void openOrders(char *orderFile);
+
+// Returns the shard an order of a customer in a category goes to
+int routeOrder(int category, int customer_id);
+
+// Adds n orders to a shard's buffer in order and schedules the shard, waits while the buffer is full
+// in adaptive mode a buffer that keeps filling up is grown instead, within the memory budget
+void publishOrders(int shard, struct info_t *orders, int n);
+
+// Returns the lock guarding a customer's balance
+pthread_mutex_t *customerLock(int customer_id);
+
+// Queues the category with the worker pool unless it is already queued or running
+void scheduleCategory(struct category_task *category);
+
+// Queues a category that ended its turn with orders left behind the categories waiting for a worker
+void rescheduleCategory(struct category_task *category);
+
+// Doubles a category buffer if the memory budget allows it
+// returns 1 if the buffer grew
+int growBuffer(orderBufferPtr orderBuffer);
+
+// Adds an order to the producer's batch for its shard, publishing the batch once it is full
+void batchOrder(producerPtr producer, int shard, const struct info_t *oinf);
+
+// Publishes the producer's batches, all of them or only those older than BATCH_TIMEOUT_MS
+void flushBatches(producerPtr producer, int all);
+
+// Parses the orders between start and end, publishing them now or staging them in the producer
+void parseOrders(producerPtr producer, char *start, char *end, int publishNow);
+
+// Follow mode producer loop, parses complete lines as they are appended to the orders file
+// inotify wakes it when the file changes
+void followOrders(producerPtr producer);
+
+// **** PRODUCER(S) ****
+// parses its chunks of the orders file and adds sales to the appropriate category buffer
+// in follow mode it reads the orders file as it grows instead, until asked to stop
+// chunks are published in file order, so every buffer sees its orders in file order
 // shouts to consumer that a new order is available
-// releases all threads waiting upon its exit
+// the last producer to finish closes every category buffer
 void *addNewOrder(void *args);
 
+// returns 1 once main asked a following producer to stop
+int checkStopFollowing();
+
 // **** CONSUMER(S) ****
-// Continuously checks the category buffer for available orders
-// If the producer is finished reading the orders file and there is no more orders in the buffer, exit
-// Shouts to main whenever a consumer exits, main waits for all consumers to finish
-void *processOrder(void *args);
+// Pool task for one category shard, processes up to CATEGORY_TURN batches of its orders
+// and queues the category again if more are waiting
+// Once its buffer is closed by the producers and drained, shouts to main, main waits for all categories to finish
+void runCategory(void *args);
 
 // Print report lists for debugging
 void SLPrint(SortedListPtr sl);
@@ -1,26 +1,28 @@
 /*
- * Original tokenizer.c given to us for PA3, nothing was altered
+ * Original tokenizer.c given to us for PA3
+ * ALTERED so a line is scanned once: the string length and the set of delimiters
+ * are computed in TKCreate and token ends are found 16 bytes at a time
  */
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <ctype.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "tokenizer.h"
+
 #define MAX_HEX_CHARS 2
 #define MAX_OCT_CHARS 3
+#define MAX_SIMD_DELIMS 4 //larger delimiter sets use the lookup table only
+#define MAX_NUMBER_LEN 32 //longest number TKViewToInt will parse
 
 /*
- * Tokenizer type.  You need to fill in the type as part of your implementation.
+ * Tokenizer type, declared in tokenizer.h so view tokenizers can live on the stack
  */
 
-struct TokenizerT_ {
-	char* copied_string;
-	char* delimiters;		
-	char* current_position;
-};
-
-typedef struct TokenizerT_ TokenizerT;
-
 char is_escape_character(char character) {
 	
 	/*
@@ -104,12 +106,13 @@ char* unescape_string(char* string) {
 	 * 
 	 */
 
-	char* unescaped_string = (char*)malloc(strlen(string) * sizeof(char) + 1);
+	size_t length = strlen(string);
+	char* unescaped_string = (char*)malloc(length * sizeof(char) + 1);
 	int current_position = 0;
 	int unescaped_string_position = 0;
 	unsigned char escape_character = 0;	
 	
-	for(current_position = 0; current_position < strlen(string); current_position++) {	
+	for(current_position = 0; current_position < length; current_position++) {	
 			escape_character = *(string + current_position);
 			if(*(string + current_position) == '\\') {
 				if(*(string + current_position + 1) == 'x') {
@@ -157,6 +160,25 @@ char* unescape_string(char* string) {
 
 
 
+void build_delimiter_table(TokenizerT* tk) {
+
+	/*
+	 * Description: fills in the delimiter count and lookup table from tk->delimiters
+	 * Parameters: tokenizer whose delimiters are set
+	 * Modifies: tk->num_delimiters, tk->delimiter_table
+	 * Returns: nothing
+	 */
+
+	int i;
+
+	tk->num_delimiters = strlen(tk->delimiters);
+	memset(tk->delimiter_table, 0, sizeof(tk->delimiter_table));
+	for(i = 0; i < tk->num_delimiters; i++) {
+		tk->delimiter_table[(unsigned char) tk->delimiters[i]] = 1;
+	}
+}
+
+
 /*
  * TKCreate creates a new TokenizerT object for a given set of separator
  * characters (given as a string) and a token stream (given as a string).
@@ -194,6 +216,8 @@ TokenizerT *TKCreate(char *separators, char *ts) {
 	tokenizer->delimiters = unescape_string(separators);
 	tokenizer->copied_string = unescape_string(ts);
 	tokenizer->current_position = tokenizer->copied_string;
+	tokenizer->end = tokenizer->copied_string + strlen(tokenizer->copied_string);
+	build_delimiter_table(tokenizer);
 	
 	return tokenizer;
 }
@@ -222,23 +246,58 @@ void TKDestroy(TokenizerT *tk) {
 }
 
 
-char is_delimiter(char character, char* delimiters) {
+char is_delimiter(char character, TokenizerT* tk) {
 	
 	/*
 	 * Description: determines if a particular character is a member of the set of delimiters
-	 * Parameters: character to be compared, string of delimiters
+	 * Parameters: character to be compared, tokenizer holding the delimiter table
 	 * Modifies: Nothing
 	 * Returns: 1 if character is a delimiter, 0 if it is not
 	 */
 	
-	char* current = NULL;
-	
-	for(current = delimiters; current - delimiters < strlen(delimiters); current++) {
-		if(character == *current) {
-			return 1;
+	return tk->delimiter_table[(unsigned char) character];
+}
+
+
+char* find_delimiter(char* position, TokenizerT* tk) {
+
+	/*
+	 * Description: finds the first delimiter at or after position, comparing a whole vector
+	 * 		of characters against every delimiter at once when the delimiter set is small
+	 * Parameters: starting position, tokenizer holding the delimiters
+	 * Modifies: Nothing
+	 * Returns: pointer to the first delimiter, or tk->end if there is none
+	 */
+
+#if defined(__SSE2__)
+	//SSE2 is part of every x86-64 cpu, so it is what the shipped flags build
+	if(tk->num_delimiters > 0 && tk->num_delimiters <= MAX_SIMD_DELIMS) {
+		int i;
+		unsigned int mask;
+		__m128i delims[MAX_SIMD_DELIMS];
+		for(i = 0; i < tk->num_delimiters; i++) {
+			delims[i] = _mm_set1_epi8(tk->delimiters[i]);
+		}
+		while(tk->end - position >= 16) {
+			__m128i chunk = _mm_loadu_si128((const __m128i*) position);
+			__m128i hits = _mm_cmpeq_epi8(chunk, delims[0]);
+			for(i = 1; i < tk->num_delimiters; i++) {
+				hits = _mm_or_si128(hits, _mm_cmpeq_epi8(chunk, delims[i]));
+			}
+			mask = (unsigned int) _mm_movemask_epi8(hits);
+			if(mask != 0) {
+				return position + __builtin_ctz(mask);
+			}
+			position += 16;
 		}
 	}
-	return 0;
+#endif
+
+	//scalar fallback, also finishes the tail shorter than one vector
+	while(position < tk->end && !is_delimiter(*position, tk)) {
+		position++;
+	}
+	return position;
 }
 
 
@@ -266,28 +325,207 @@ char *TKGetNextToken(TokenizerT *tk) {
 	char* token = NULL;
 	char* token_start = NULL;
 
-	while(tk->current_position - tk->copied_string < strlen(tk->copied_string)) {
-		if(!is_delimiter(*tk->current_position, tk->delimiters)) {
-		
-			token_start = tk->current_position;
-			break;
-		}
+	//delimiter runs are short, skip them one character at a time
+	while(tk->current_position < tk->end && is_delimiter(*tk->current_position, tk)) {
 		tk->current_position++;
 	}
 	
-	if(token_start == NULL) {
+	if(tk->current_position == tk->end) {
 		return NULL;
 	}
+	token_start = tk->current_position;
 	
-	while(tk->current_position - tk->copied_string < strlen(tk->copied_string)) {
-		if(is_delimiter(*tk->current_position, tk->delimiters)) {
-			break;
-		}
-		tk->current_position++;
-	}	
+	tk->current_position = find_delimiter(token_start, tk);
 
 	token = (char*)malloc(sizeof(char) * (tk->current_position - token_start + 1));
 	strncpy(token, token_start, tk->current_position - token_start);
 	token[(tk->current_position - token_start)] = '\0';
 	return token;
 }
+
+
+/*
+ * TKInitView sets up a tokenizer that is owned by the caller.  Unlike
+ * TKCreate nothing is copied or unescaped and nothing is allocated, so the
+ * delimiter string must stay alive as long as the tokenizer is used.
+ */
+
+void TKInitView(TokenizerT *tk, char *separators) {
+
+	/*
+	 * Description: initializes a caller owned tokenizer for a set of delimiters
+	 * Parameters: tokenizer to initialize, set of delimiters
+	 * Modifies: every field of the tokenizer
+	 * Returns: nothing
+	 */
+
+	tk->delimiters = separators;
+	tk->copied_string = tk->current_position = tk->end = NULL;
+	build_delimiter_table(tk);
+}
+
+
+void TKSetText(TokenizerT *tk, char *text, size_t length) {
+
+	/*
+	 * Description: points a view tokenizer at a new token stream, keeping its delimiters
+	 * Parameters: tokenizer from TKInitView, text to split and its length
+	 * Modifies: tk->copied_string, tk->current_position, tk->end
+	 * Returns: nothing
+	 */
+
+	tk->copied_string = tk->current_position = text;
+	tk->end = text + length;
+}
+
+
+/*
+ * TKGetNextView finds the next token like TKGetNextToken but returns it as
+ * a view into the token stream instead of a new string.
+ *
+ * If there is another token it fills in the view and returns 1.
+ * Else it returns 0.
+ */
+
+int TKGetNextView(TokenizerT *tk, TokenViewT *view) {
+
+	/*
+	 * Description: returns the next token of the stream as a pointer and a length
+	 * Parameters: tokenizer from which to extract the token, view to fill in
+	 * Modifies: tokenizer->current_position: moved past the token; view
+	 * Returns: 1 on success, 0 at the end of the stream
+	 */
+
+	while(tk->current_position < tk->end && is_delimiter(*tk->current_position, tk)) {
+		tk->current_position++;
+	}
+
+	if(tk->current_position == tk->end) {
+		return 0;
+	}
+
+	view->start = tk->current_position;
+	tk->current_position = find_delimiter(view->start, tk);
+	view->length = tk->current_position - view->start;
+	return 1;
+}
+
+
+char is_trimmed(char character) {
+
+	/*
+	 * Description: determines if a character is trimmed off the ends of a token
+	 * Parameters: character to be evaluated
+	 * Modifies: nothing
+	 * Returns: 1 for null, newline, double quote and space, 0 otherwise
+	 */
+
+	return character == '\0' || character == '\n' || character == '\"' || character == ' ';
+}
+
+
+void TKTrimView(TokenViewT *view) {
+
+	/*
+	 * Description: strips spaces, quotes and newlines from both ends of a view
+	 * Parameters: view to trim
+	 * Modifies: view->start, view->length
+	 * Returns: nothing
+	 */
+
+	while(view->length > 0 && is_trimmed(view->start[view->length - 1])) {
+		view->length--;
+	}
+	while(view->length > 0 && is_trimmed(*view->start)) {
+		view->start++;
+		view->length--;
+	}
+}
+
+
+void copy_number(TokenViewT *view, char *number) {
+
+	/*
+	 * Description: copies a view into a small null terminated buffer so the
+	 *		standard conversions never read past the end of the view
+	 * Parameters: view holding the number, buffer of MAX_NUMBER_LEN characters
+	 * Modifies: number
+	 * Returns: nothing
+	 */
+
+	int length = view->length < MAX_NUMBER_LEN ? view->length : MAX_NUMBER_LEN - 1;
+
+	memcpy(number, view->start, length);
+	number[length] = '\0';
+}
+
+
+int TKViewToInt(TokenViewT *view) {
+	char number[MAX_NUMBER_LEN];
+
+	copy_number(view, number);
+	return atoi(number);
+}
+
+
+int64_t TKViewToCents(TokenViewT *view) {
+
+	/*
+	 * Description: parses a decimal dollar amount into cents without floating point,
+	 *		so the value is exact and does not depend on the locale
+	 * Parameters: view holding the amount
+	 * Modifies: nothing
+	 * Returns: the amount in cents, 0 if the view holds no number
+	 */
+
+	char* position = view->start;
+	char* end = view->start + view->length;
+	int64_t cents = 0;
+	int negative = 0;
+	int decimals = 0;
+
+	while(position < end && isspace((unsigned char) *position)) {
+		position++;
+	}
+	if(position < end && (*position == '-' || *position == '+')) {
+		negative = (*position == '-');
+		position++;
+	}
+	while(position < end && isdigit((unsigned char) *position)) {
+		cents = cents * 10 + (*position - '0');
+		position++;
+	}
+	if(position < end && *position == '.') {
+		position++;
+		while(position < end && isdigit((unsigned char) *position) && decimals < 2) {
+			cents = cents * 10 + (*position - '0');
+			position++;
+			decimals++;
+		}
+		if(position < end && isdigit((unsigned char) *position) && *position >= '5') {
+			cents++;
+		}
+	}
+	for(; decimals < 2; decimals++) {
+		cents *= 10;
+	}
+
+	return negative ? -cents : cents;
+}
+
+
+char *TKViewDup(TokenViewT *view) {
+
+	/*
+	 * Description: materializes a view as its own string
+	 * Parameters: view to copy
+	 * Modifies: nothing
+	 * Returns: a new null terminated string the caller has to free
+	 */
+
+	char* copy = (char*)malloc(sizeof(char) * (view->length + 1));
+
+	memcpy(copy, view->start, view->length);
+	copy[view->length] = '\0';
+	return copy;
+}
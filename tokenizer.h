@@ -8,16 +8,55 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>
 
 struct TokenizerT_ {
-	char * delims;
-	char * text;
+	char* copied_string; //owned by TKCreate tokenizers, borrowed by TKInitView ones
+	char* delimiters;
+	char* current_position;
+	char* end; //one past the last character of the token stream
+	int num_delimiters;
+	unsigned char delimiter_table[256]; //1 for every delimiter character
 };
 
 typedef struct TokenizerT_ TokenizerT;
 
+/*
+ * A token returned by TKGetNextView, it points into the text given to TKSetText
+ * and is not null terminated
+ */
+struct TokenView_ {
+	char * start;
+	int length;
+};
+
+typedef struct TokenView_ TokenViewT;
+
 TokenizerT *TKCreate(char *, char *);
 void TKDestroy(TokenizerT *);
 char *TKGetNextToken(TokenizerT *);
 
+/*
+ * Allocation free tokenizing: TKInitView sets up a caller owned tokenizer
+ * (usually on the stack) for a set of delimiters, taken literally, and
+ * TKSetText points it at the next line to split. Nothing is copied, the text
+ * has to outlive the views and the tokenizer is never passed to TKDestroy.
+ */
+void TKInitView(TokenizerT *, char *);
+void TKSetText(TokenizerT *, char *, size_t);
+int TKGetNextView(TokenizerT *, TokenViewT *);
+
+// Trims spaces, quotes and newlines off both ends by moving the view
+void TKTrimView(TokenViewT *);
+
+// Parse numbers out of a view without allocating
+int TKViewToInt(TokenViewT *);
+
+// Parses a decimal amount such as 12.5 straight into integer cents (1250)
+// digits past the cents are rounded half up, parsing stops at the first other character
+int64_t TKViewToCents(TokenViewT *);
+
+// Copies a view into a new null terminated string, the caller frees it
+char *TKViewDup(TokenViewT *);
+
 #endif
\ No newline at end of file
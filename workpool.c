@@ -0,0 +1,161 @@
+#include "workpool.h"
+
+//the worker running on this thread, NULL on threads outside any pool
+_Thread_local struct pool_worker *currentWorker;
+
+//takes the oldest task from the injection queue, NULL if it is empty
+void *takeInjected(workerPoolPtr pool){
+	void *task = NULL;
+
+	pthread_mutex_lock(&pool->lock);
+	if(pool->injectedCount > 0){
+		task = pool->injected[pool->injectedFront];
+		pool->injectedFront = (pool->injectedFront + 1) % pool->capacity;
+		pool->injectedCount--;
+	}
+	pthread_mutex_unlock(&pool->lock);
+	return task;
+}
+
+//tries every other worker's deque once, starting with the next worker
+void *stealTask(struct pool_worker *worker){
+	workerPoolPtr pool = worker->pool;
+	void *task;
+	int i;
+
+	for(i = 1; i < pool->numWorkers; i++){
+		if((task = dequeSteal(&pool->workers[(worker->id + i) % pool->numWorkers].deque)) != NULL)
+			return task;
+	}
+	return NULL;
+}
+
+void *runWorker(void *args){
+	struct pool_worker *worker = (struct pool_worker *) args;
+	workerPoolPtr pool = worker->pool;
+	void *task;
+	int idle = 0;
+
+	currentWorker = worker;
+	while(1){
+		//the shared queue is only locked when something is queued
+		task = dequeTake(&worker->deque);
+		if(task == NULL && atomic_load(&pool->queued) > 0)
+			task = takeInjected(pool);
+		if(task == NULL && atomic_load(&pool->queued) > 0)
+			task = stealTask(worker);
+
+		if(task != NULL){
+			atomic_fetch_sub(&pool->queued, 1);
+			pool->run(task);
+			idle = 0;
+			continue;
+		}
+
+		//a producer is likely to schedule a category again soon, keep looking a while
+		if(backoff(&pool->policy, &idle))
+			continue;
+		idle = 0;
+
+		//announce the sleep before the last look at queued: a submit either
+		//sees this worker sleeping or this worker sees its task counted
+		pthread_mutex_lock(&pool->lock);
+		if(pool->stopping){
+			pthread_mutex_unlock(&pool->lock);
+			break;
+		}
+		atomic_fetch_add(&pool->sleeping, 1);
+		if(atomic_load(&pool->queued) == 0){
+			printf("Worker %d waiting for orders\n", worker->id);
+			pthread_cond_wait(&pool->workAvailable, &pool->lock);
+		}
+		atomic_fetch_sub(&pool->sleeping, 1);
+		pthread_mutex_unlock(&pool->lock);
+	}
+
+	printf("Worker %d exiting\n", worker->id);
+	return NULL;
+}
+
+void startWorkers(workerPoolPtr pool, int numWorkers, int capacity, TaskFuncT run, const struct wait_policy *policy){
+	int i;
+
+	pool->numWorkers = numWorkers;
+	pool->run = run;
+	pthread_mutex_init(&pool->lock, NULL);
+	pthread_cond_init(&pool->workAvailable, NULL);
+	pool->capacity = capacity;
+	pool->injected = (void **) calloc(capacity, sizeof(void *));
+	pool->injectedFront = pool->injectedCount = 0;
+	pool->stopping = 0;
+	atomic_init(&pool->queued, 0);
+	atomic_init(&pool->sleeping, 0);
+	pool->policy = *policy;
+
+	//every deque is set up before any worker can steal from it
+	pool->workers = (struct pool_worker *) calloc(numWorkers, sizeof(struct pool_worker));
+	for(i = 0; i < numWorkers; i++){
+		pool->workers[i].id = i;
+		pool->workers[i].pool = pool;
+		initDeque(&pool->workers[i].deque, capacity);
+	}
+	for(i = 0; i < numWorkers; i++)
+		pthread_create(&pool->workers[i].tid, NULL, runWorker, &pool->workers[i]);
+}
+
+//adds a counted task at the back of the injection queue
+void injectTask(workerPoolPtr pool, void *task){
+	pthread_mutex_lock(&pool->lock);
+	pool->injected[(pool->injectedFront + pool->injectedCount) % pool->capacity] = task;
+	pool->injectedCount++;
+	if(atomic_load(&pool->sleeping) > 0)
+		pthread_cond_signal(&pool->workAvailable);
+	pthread_mutex_unlock(&pool->lock);
+}
+
+void submitTask(workerPoolPtr pool, void *task){
+	struct pool_worker *worker = currentWorker;
+
+	//counted before it is queued so a worker never sleeps on a task being added
+	atomic_fetch_add(&pool->queued, 1);
+
+	if(worker != NULL && worker->pool == pool){
+		dequePush(&worker->deque, task);
+		if(atomic_load(&pool->sleeping) > 0){
+			pthread_mutex_lock(&pool->lock);
+			pthread_cond_signal(&pool->workAvailable);
+			pthread_mutex_unlock(&pool->lock);
+		}
+	}
+	else
+		injectTask(pool, task);
+}
+
+void yieldTask(workerPoolPtr pool, void *task){
+	//a worker's own deque is taken newest first, the task would come straight back
+	atomic_fetch_add(&pool->queued, 1);
+	injectTask(pool, task);
+}
+
+void stopWorkers(workerPoolPtr pool){
+	int i;
+
+	if(pool->workers == NULL)
+		return;
+
+	pthread_mutex_lock(&pool->lock);
+	pool->stopping = 1;
+	pthread_cond_broadcast(&pool->workAvailable);
+	pthread_mutex_unlock(&pool->lock);
+
+	for(i = 0; i < pool->numWorkers; i++)
+		pthread_join(pool->workers[i].tid, NULL);
+	for(i = 0; i < pool->numWorkers; i++)
+		destroyDeque(&pool->workers[i].deque);
+	free(pool->workers);
+	pool->workers = NULL;
+	free(pool->injected);
+	pool->injected = NULL;
+	pthread_mutex_destroy(&pool->lock);
+	pthread_cond_destroy(&pool->workAvailable);
+}
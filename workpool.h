@@ -0,0 +1,68 @@
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include "deque.h"
+#include "backoff.h"
+
+/*
+ * Fixed size pool of worker threads
+ *
+ * Every worker owns a work-stealing deque. A task submitted by a worker goes on
+ * its own deque, a task submitted by any other thread goes on the pool's shared
+ * injection queue, as does a task yielded to let the queued ones run. An idle worker looks in its own deque, then the injection
+ * queue, then steals from the other workers. With no task queued anywhere it
+ * spins and yields as the pool's wait_policy allows, then sleeps.
+ *
+ * Tasks are opaque pointers handed to the pool's run function. The pool does not
+ * stop a task from being queued twice, callers that need a task to run on one
+ * worker at a time keep their own flag. At most capacity tasks may be queued at once.
+ */
+
+typedef void (*TaskFuncT)(void *task);
+
+struct pool_worker{
+	pthread_t tid;
+	int id;
+	struct work_deque deque;
+	struct worker_pool *pool;
+};
+
+struct worker_pool{
+	struct pool_worker *workers;
+	int numWorkers;
+	TaskFuncT run;
+
+	//tasks submitted from outside the pool, a circular queue under lock
+	pthread_mutex_t lock;
+	pthread_cond_t workAvailable;
+	void **injected;
+	int capacity;
+	int injectedFront;
+	int injectedCount;
+	int stopping;
+
+	atomic_long queued; //tasks waiting in the injection queue and every deque
+	atomic_int sleeping; //workers waiting on workAvailable
+	struct wait_policy policy; //how long an idle worker keeps looking before it sleeps
+};
+typedef struct worker_pool * workerPoolPtr;
+
+// Starts numWorkers workers that pass every task to run, idle workers wait as policy says
+void startWorkers(workerPoolPtr pool, int numWorkers, int capacity, TaskFuncT run, const struct wait_policy *policy);
+
+// Queues a task, wakes a sleeping worker if there is one
+void submitTask(workerPoolPtr pool, void *task);
+
+// Queues a task that gave up its turn behind every task waiting in the injection queue,
+// so each of them runs before it does again
+void yieldTask(workerPoolPtr pool, void *task);
+
+// Stops the workers once they finish the task they are running and waits for them
+// tasks still queued are dropped
+void stopWorkers(workerPoolPtr pool);
+
+#endif